@@ -6,9 +6,14 @@
 #define CPPGFUNCTION_BOREHOLES_H
 
 #include <iostream>
+#include <cstdint>
+#include <map>
 #include <math.h>
+#include <string>
 #include <tuple>
+#include <unordered_map>
 #include <vector>
+#include <cpgfunction/executor.h>
 
 namespace gt {
 
@@ -37,18 +42,110 @@ namespace gt {
         std::vector<Borehole> boreField(const std::vector<std::tuple<double, double>> &coordinates, const double &r_b,
                                         const double &H, const double &D);
 
+        // The symmetries of a bore field: the rotations by a multiple of 90 degrees and the reflections about the
+        // centroid of the field (about an axis parallel to x, to y or to a diagonal) that map every borehole onto a
+        // borehole of the same H, D and r_b within tol (meters). Each symmetry is the permutation of the boreholes
+        // it makes, the identity being the first. A finite field has no translation symmetry.
+        std::vector<std::vector<int>> symmetry_group(std::vector<Borehole> &boreField, double tol=1.0e-6);
+
+        // The similarities in a compressed sparse row layout: the pairs (iSim[k], jSim[k]) of similarity s are
+        // k = offset[s], ..., offset[s+1] - 1, the first one being the representative pair of the similarity. The
+        // lengths, burial depths and distance of the representative pair are kept per similarity.
         struct SimilaritiesType {
             ~SimilaritiesType() {} // destructor
 
             int nSim = 0;
-            vector< vector <tuple<int, int> > > Sim;
-            vector<tuple<double, double>> HSim;
-            vector<tuple<double, double>> DSim;
+            vector<int64_t> offset{0};  // nSim + 1 offsets into iSim and jSim
+            vector<int32_t> iSim;
+            vector<int32_t> jSim;
+            vector<double> H1Sim;
+            vector<double> H2Sim;
+            vector<double> D1Sim;
+            vector<double> D2Sim;
             vector<double> disSim;
 
             SimilaritiesType() {} // constructor
+
+            int64_t nPairs(const int s) const { return offset[s + 1] - offset[s]; }  // number of pairs of s
+            size_t bytes() const;  // memory held
         };
 
+        // The similarity classes of the segment pairs of one distance, with a hash index on the (H1, H2, D) of each
+        // class so that the class of a pair is found without comparing it with every class. kind is "real",
+        // "image" or "realandimage".
+        class SimilarityClasses {
+        public:
+            explicit SimilarityClasses(const string &kind, double tol=1.0e-6); // constructor
+            ~SimilarityClasses() {} // destructor
+
+            int size() const { return int(H1.size()); }  // number of classes
+            // The lowest class the pair (b1, b2) is in: s when (b1, b2) is in class s, -1 - s when it is (b2, b1)
+            // that is in class s (the first being checked first), size() when the pair is in none
+            int match(const Borehole &b1, const Borehole &b2) const;
+            // Adds the class of the pair (b1, b2)
+            void add(const Borehole &b1, const Borehole &b2);
+
+            // the segment lengths and burial depths of the first pair of each class
+            vector<double> H1;
+            vector<double> H2;
+            vector<double> D1;
+            vector<double> D2;
+
+        private:
+            // The cell of a class: log(H1), log(H2), then the sign and log of the depth term(s)
+            struct Key {
+                int64_t q[6];
+                bool operator==(const Key &other) const;
+            };
+            struct KeyHash {
+                size_t operator()(const Key &key) const;
+            };
+
+            int kind;  // 0: real, 1: image, 2: realandimage
+            double tol;
+            unordered_map<Key, vector<int>, KeyHash> cells;
+
+            void _key(Key &key, double H1, double H2, double D1, double D2) const;
+            // the lowest class of the cell of (H1, H2, D1, D2) that matches, size() when there is none
+            int _find(double H1, double H2, double D1, double D2) const;
+        };  // class SimilarityClasses
+
+        // The similarities of the segment pairs, found in a pass over the pairs that does not keep them: only the
+        // distances, the classes and the first pair of each class are kept. classify() then finds the similarities
+        // of a pair again, so the pairs are streamed rather than stored. The similarities, and the similarity of
+        // every pair, are those of Similarity::similarities (the pairs of a similarity are not listed, SimReal and
+        // SimImage hold the first pair of each similarity).
+        class SimilarityStream {
+        public:
+            SimilarityStream(vector<Borehole> &boreSegments, double disTol=0.1, double tol=1.0e-6,
+                             gt::parallel::TaskGroup *pool=nullptr); // constructor
+            ~SimilarityStream() {} // destructor
+
+            // The real and image similarity of the pair (i, j), i <= j: s when (i, j) is in similarity s, -1 - s
+            // when (j, i) is in similarity s
+            void classify(int i, int j, int &real, int &image) const;
+
+            SimilaritiesType SimReal;
+            SimilaritiesType SimImage;
+
+        private:
+            vector<Borehole> &boreSegments;
+            double disTol;
+            double tol;
+            multimap<double, int> sorted_dis;  // the distance of each group
+            vector<double> disPairs;
+            vector<SimilarityClasses> real;  // the classes of each distance
+            vector<SimilarityClasses> image;
+            vector<vector<int32_t>> realFirst;  // the first pair of each class of each distance
+            vector<vector<int32_t>> imageFirst;
+            vector<int> realOffset;  // the first similarity of each distance
+            vector<int> imageOffset;
+
+            // the group of the distance of the pair (i, j), -1 when there is none; dis is set to the distance
+            int _group(int i, int j, double &dis) const;
+            void _add_group(double dis, int i, int j);
+        };  // class SimilarityStream
+
         struct Similarity {
             ~Similarity() {} // destructor
 
@@ -71,12 +168,15 @@ namespace gt {
 
             void similarities(SimilaritiesType &SimReal, SimilaritiesType &SimImage,
                               vector<gt::boreholes::Borehole> &boreSegments,
-                              bool splitRealAndImage = true, double disTol = 0.1, double tol = 1.0e-6);
+                              bool splitRealAndImage = true, double disTol = 0.1, double tol = 1.0e-6,
+                              gt::parallel::TaskGroup *pool = nullptr);
 
+            // Groups the segment pairs by distance, the pairs being compared in parallel on pool (nullptr uses
+            // every thread of the process-wide executor)
             void _similarities_group_by_distance(vector<gt::boreholes::Borehole> &boreSegments,
                                                  vector<vector<tuple<int, int> > > &Pairs,
                                                  vector<int> &nPairs, vector<double> &disPairs, int &nDis,
-                                                 double disTol = 0.1);
+                                                 double disTol = 0.1, gt::parallel::TaskGroup *pool = nullptr);
 
             void _similarities_one_distance(SimilaritiesType &SimT, vector<tuple<int, int> > &pairs,
                                             vector<gt::boreholes::Borehole> &boreSegments, const string &kind,
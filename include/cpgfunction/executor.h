@@ -0,0 +1,75 @@
+#ifndef CPGFUNCTION_EXECUTOR_H
+#define CPGFUNCTION_EXECUTOR_H
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace gt { namespace parallel {
+
+    // A long-lived set of worker threads shared by every phase of the g-function calculation (and by every
+    // g-function computed in the process), so that no threads are created or joined per call or per time step.
+    // Work is not posted to the executor directly but through a TaskGroup, which bounds how many of its tasks
+    // run at once.
+    class Executor {
+    public:
+        // nWorkers < 0 starts one worker less than the number of hardware threads, the thread waiting on a
+        // TaskGroup being the last one
+        explicit Executor(int nWorkers=-1); // constructor
+        ~Executor(); // destructor, finishes the queued tasks and joins the workers
+
+        // The process-wide executor, started on first use
+        static Executor& instance();
+
+        int size() const { return int(workers.size()); }  // number of worker threads
+        void post(std::function<void()> task);
+
+    private:
+        std::vector<std::thread> workers;
+        std::mutex mtx;
+        std::condition_variable cv;
+        std::deque<std::function<void()>> tasks;
+        bool stopping = false;
+
+        void _work();
+    };  // class Executor
+
+    // A set of tasks run on an Executor, of which at most nThreads run at the same time; the thread calling
+    // wait() runs tasks too and counts as one of them. nThreads <= 0 uses every worker of the executor. The first
+    // exception thrown by a task is rethrown by wait(). A group can be reused after wait() returns.
+    class TaskGroup {
+    public:
+        explicit TaskGroup(Executor &executor=Executor::instance(), int nThreads=0); // constructor
+        ~TaskGroup(); // destructor, waits for the tasks
+
+        void run(std::function<void()> task);
+        void wait();
+
+        int concurrency() const { return nRunners + 1; }  // number of tasks run at the same time
+
+    private:
+        struct State {
+            std::mutex mtx;
+            std::condition_variable cv;
+            std::deque<std::function<void()>> tasks;
+            long nPending = 0;  // tasks queued or running
+            int nActive = 0;  // runners posted to the executor
+            std::exception_ptr error;
+        };
+
+        Executor &executor;
+        int nRunners;  // maximum number of runners posted to the executor
+        std::shared_ptr<State> state;
+
+        // runs the queued tasks of a group until there are none left
+        static void _drain(const std::shared_ptr<State> &state, bool runner);
+    };  // class TaskGroup
+
+} } // namespace gt::parallel
+
+#endif //CPGFUNCTION_EXECUTOR_H
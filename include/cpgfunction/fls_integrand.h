@@ -0,0 +1,34 @@
+#ifndef CPGFUNCTION_FLS_INTEGRAND_H
+#define CPGFUNCTION_FLS_INTEGRAND_H
+
+#include <cpgfunction/boreholes.h>
+
+namespace gt { namespace heat_transfer {
+
+    // The integrand of the finite line source solution for one pair of segments, evaluated for a batch of
+    // quadrature nodes at a time. Each of the (up to eight) real and image erfint terms is a multiple of the
+    // integration variable s, so the terms are stored as coefficients once and reused for every node.
+    struct FLSIntegrand {
+        ~FLSIntegrand() {} // destructor
+
+        int nTerms = 0;     // number of erfint terms (4 real and/or 4 image)
+        double d[8];        // erfint(d[m] * s)
+        double sign[8];     // sign of each erfint term
+        double r;           // distance between the segments
+        double H2;          // length of the receiving segment
+
+        FLSIntegrand(gt::boreholes::Borehole &b1, gt::boreholes::Borehole &b2, bool reaSource=true,
+                     bool imgSource=true); // constructor
+
+        // f[i] = Ils(s[i]) for i in [0, n), computed with the fastest evaluator the CPU supports
+        void evaluate(const double *s, double *f, int n) const;
+        // f[i] = Ils(s[i]) for i in [0, n), computed with std::erf and std::exp
+        void evaluate_scalar(const double *s, double *f, int n) const;
+    };  // struct FLSIntegrand
+
+    // The instruction set selected at runtime for FLSIntegrand::evaluate ("avx512f", "avx2" or "scalar")
+    const char* fls_integrand_isa();
+
+} } // namespace gt::heat_transfer
+
+#endif //CPGFUNCTION_FLS_INTEGRAND_H
@@ -7,10 +7,13 @@
 #ifndef CPPGFUNCTION_GFUNCTION_H
 #define CPPGFUNCTION_GFUNCTION_H
 
+#include <functional>
 #include <iostream>
+#include <map>
 #include <vector>
 #include <cpgfunction/boreholes.h>
 #include <cpgfunction/heat_transfer.h>
+#include <cpgfunction/options.h>
 
 using namespace std;
 
@@ -31,22 +34,142 @@ namespace gfunction {
      * @param alpha
      * @param nSegments
      * @param use_similarities
+     * @param adaptive unused, kept so that the arguments after it keep their positions
+     * @param n_Threads the maximum number of threads used at the same time, 0 uses every thread of the executor
      * @param disp
+     * @param options selects between the computational paths, see gt::options::Options
      */
     vector<double> uniform_borehole_wall_temperature(
             vector<gt::boreholes::Borehole> &boreField,
             vector<double> &time, double alpha, int nSegments=12,
-            bool use_similarities=true, bool adaptive=true, int n_Threads=1,
-            bool multi_thread=true, bool display=false);
+            bool use_similarities=true, bool adaptive=true, int n_Threads=0,
+            bool multi_thread=true, bool display=false,
+            const gt::options::Options &options=gt::options::Options());
+
+    /**
+     * Uniform borehole wall temperature (UBWHT) g-function that is extended in time
+     *
+     * The segment response factors, the segment heat extraction rates and the g-function of every time step already
+     * solved are kept, so that appending time values only computes the response factors at the new time values and
+     * solves the new time steps. A g-function extended in parts is the same as the one computed over the whole time
+     * vector by uniform_borehole_wall_temperature.
+     *
+     * @param boreField
+     * @param alpha
+     * @param nSegments
+     * @param use_similarities
+     * @param n_Threads the maximum number of threads used at the same time, 0 uses every thread of the executor
+     * @param multi_thread
+     * @param display
+     * @param options selects between the computational paths, see gt::options::Options
+     */
+    class UniformBoreholeWallTemperature {
+    public:
+        UniformBoreholeWallTemperature(vector<gt::boreholes::Borehole> &boreField, double alpha, int nSegments=12,
+                bool use_similarities=true, int n_Threads=0, bool multi_thread=true, bool display=false,
+                const gt::options::Options &options=gt::options::Options()); // constructor
+        ~UniformBoreholeWallTemperature() {} // destructor
+
+        // Appends time values (each greater than the last one) and returns the g-function at every time value
+        vector<double>& extend(vector<double> &time_new);
+
+        vector<double> time;  // every time value solved
+        vector<double> gFunction;  // the g-function at every time value
+
+    private:
+        double alpha;
+        int nSegments;
+        bool use_similarities;
+        int n_Threads;
+        bool multi_thread;
+        bool display;
+        gt::options::Options options;
+        int nSources;
+        int nSum;
+        gt::heat_transfer::SegmentResponse SegRes;
+        vector<gt::boreholes::Borehole> boreSegments;
+        vector<float> Hb;  // segment lengths
+        double Hb_sum;
+        vector<vector<double> > Q;  // segment heat extraction rates
+        vector<double> _time;  // time vector that starts at 0
+        vector<double> _time_untouched;
+        vector<double> dt;
+        int nOrbits;  // number of unknown segment heat extraction rates
+        vector<int> orbitOf;  // the orbit of each segment under the symmetries of the field
+        vector<int> orbitRep;  // the first segment of each orbit
+        // The LU factorization (dgetrf) of the system of equations of a time step, or the packed LDL^T
+        // factorization (dsptrf) of its segment block with Options::packed_solver
+        struct Factorization {
+            vector<double> A;
+            vector<int> ipiv;
+        };
+        std::map<double, Factorization> factorizations;  // of each time step dt (Options::factorization_cache)
+    };  // class UniformBoreholeWallTemperature
+
+    /**
+     * A bore field of a batch of g-function calculations
+     */
+    struct BoreFieldDefinition {
+        ~BoreFieldDefinition() {} // destructor
+
+        vector<tuple<double, double>> coordinates;
+        double H = 0.;
+        double D = 0.;
+        double r_b = 0.;
+        double alpha = 0.;
+        vector<double> time;
+        int nSegments = 12;
+
+        BoreFieldDefinition() {} // constructor
+    };
+
+    /**
+     * Uniform borehole wall temperature (UBWHT) g-functions of a batch of bore fields
+     *
+     * The fields are computed at the same time on one executor, at most n_Threads tasks at a time over the whole
+     * batch, rather than one after the other. Each field is a task of its own, the threads left over when there are
+     * fewer fields than threads are shared by the phases of each field. The fields share one FLS kernel cache:
+     * options.fls_cache when set, otherwise a cache that lives for the batch. result(i, gFunction) is called as soon
+     * as the g-function of fields[i] is solved, in the order the fields finish, one call at a time.
+     *
+     * @param fields
+     * @param result
+     * @param n_Threads the maximum number of threads used at the same time, 0 uses every thread of the executor
+     * @param options selects between the computational paths, see gt::options::Options
+     */
+    void uniform_borehole_wall_temperature(vector<BoreFieldDefinition> &fields,
+            const std::function<void(int, vector<double>&)> &result, int n_Threads=0,
+            const gt::options::Options &options=gt::options::Options());
 
     void _borehole_segments(vector<gt::boreholes::Borehole>& boreSegments,
                             vector<gt::boreholes::Borehole>& boreholes, int nSegments);
     void load_history_reconstruction(vector<double>& q_reconstructed, vector<double>& time,
                                      vector<double>& _time, vector<vector<double> >& Q,
                                      vector<double>& dt, const int p);
+    // y = y + h x over every pair of segments, h being the response factors interpolated as the blend
+    // w0 * h(k) + w1 * h(k + 1) of two time slices (see jcc::interpolation::interp_weights), the response of
+    // segment j on segment i > j scaled as get_h_value does
+    void _interpolated_product(vector<double> &y, gt::heat_transfer::SegmentResponse &SegRes, int k, double w0,
+                               double w1, const double *x);
+    // Only the times k < k_end are superposed when k_end >= 0 (storage_mode 0 and 1)
     void _temporal_superposition(vector<double>& Tb_0, gt::heat_transfer::SegmentResponse &SegRes,
-                                 vector<double> &h_ij, vector<double> &q_reconstructed, int p, int &nSources);
-    void _solve_eqn(vector<double>& x, vector<vector<double>>& A, vector<double>& b);
+                                 vector<double> &q_reconstructed, int p, int &nSources, int k_end=-1);
+    // _temporal_superposition with the reconstructed loads of consecutive times aggregated: the loads of a block of
+    // times that differ by no more than tol times the largest load are replaced by their mean (weighted by the
+    // increments of the response factors), so that the block takes one product with the response factors rather than
+    // one per time
+    void _aggregated_superposition(vector<double>& Tb_0, gt::heat_transfer::SegmentResponse &SegRes,
+                                   vector<double> &q_reconstructed, int p, int nSources, double tol);
+    // The superposition of the time steps p0, ..., p0 + nBlock - 1 over the reconstructed loads of the intervals
+    // that end by _time[p0], known from the heat extraction rates of the steps before p0: the loads of the steps
+    // superposed with the same time k are the columns of one symmetric matrix product (dsymm) with the time slice
+    // unpacked, which reads the slice once for every step. Tb_far[c * nSources + i] is the superposition of step
+    // p0 + c, which needs only the times k < k_far[c] superposed at that step (_temporal_superposition with
+    // k_end = k_far[c]). dh holds nSources * nSources values, the time slice unpacked to the lower triangle of a full
+    // matrix (column-major), allocated once by the caller for every block.
+    void _far_superposition(vector<double> &Tb_far, vector<int> &k_far, gt::heat_transfer::SegmentResponse &SegRes,
+                            vector<double> &time, vector<double> &_time, vector<vector<double> > &Q,
+                            vector<double> &dt, int p0, int nBlock, vector<double> &dh);
 
 }  // namespace gt
 } // namespace gfunction
@@ -6,8 +6,10 @@
 #define CPPGFUNCTION_HEAT_TRANSFER_H
 
 #include <iostream>
+#include <memory>
 #include <vector>
 #include <cpgfunction/boreholes.h>
+#include <cpgfunction/options.h>
 #include <boost/math/quadrature/gauss_kronrod.hpp>
 #include <boost/asio.hpp>
 
@@ -16,31 +18,104 @@ using namespace std;
 
 namespace gt { namespace heat_transfer {
 
+    class HMatrix;
+
     struct SegmentResponse {
         ~SegmentResponse() {} // destructor
 
         int nSources;
         int nSum;
-        vector < vector < double > > h_ij;
+        int nt;
+        // storage_mode = 1: the response factors of every index at every time in a single 64 byte aligned buffer,
+        // time-major: h_ij[k * nSum + index]. Each time slice is the packed lower matrix consumed by
+        // _temporal_superposition.
+        double *h_ij;
+        // storage_mode = 0: one curve per similarity and the similarity of each index. Every index is the upper
+        // (i <= j) or the lower pair of exactly one real and one image similarity.
+        int nSim = 0;               // number of real and image similarities
+        vector<double> hSim;        // nSim x nt, the response of each similarity (the real ones first)
+        vector<double> ratioSim;    // the ratio b2.H / b1.H an upper pair of each similarity is scaled by
+        vector<int> simOf;          // 2 x nSum, the real and image similarity s of each index as 2 * s (upper
+                                    // pair) or 2 * s + 1 (lower pair), -1 for none
+        // storage_mode = 2: the time slices as a hierarchical matrix of dense and low rank blocks (see hmatrix.h)
+        std::shared_ptr<HMatrix> hMatrix;
+        // The indices that are not 0 at every time from the first time they are not, ordered by that time, and
+        // the number of them at each time (storage_mode = 1); set by index_nonzeros, empty otherwise. The response
+        // factors of the pairs pruned at early times (Options::fls_prune_tol) are 0, so the early time slices are
+        // gone over sparsely.
+        vector<int> nonZero;
+        vector<int> nonZeroRow;     // the row i of each index (i, j) of nonZero
+        vector<int> nNonZero;       // nt, the number of the leading indices of nonZero that are not 0 at time k
+        // The differences of consecutive time slices, dh_ij[k * nSum + index] = h(k) - h(k - 1) (h(-1) = 0), which
+        // _temporal_superposition otherwise forms at every time step; set by difference_slices, empty otherwise
+        vector<double> dh_ij;
         vector<gt::boreholes::Borehole> boreSegments;
 
-        SegmentResponse(int nSources, int nSum, int nt) : nSources(nSources), boreSegments(nSources),
-        h_ij(nSum, vector<double>(nt, 0)), nSum(nSum)
-        {} // constructor
+        SegmentResponse(int nSources, int nSum, int nt, int storage_mode=1); // constructor
+        SegmentResponse(const SegmentResponse &other); // copy constructor
+        SegmentResponse& operator=(const SegmentResponse &other);
 
-        // storage_mode = 1 is the reduced segment response vector
+        // storage_mode = 1 is the reduced segment response vector, storage_mode = 0 is the similarity indexed one,
+        // storage_mode = 2 is the compressed one
         int storage_mode = 1;
 
+        // The packed matrix of the response factors at time k (storage_mode = 1)
+        double* slice(const int k) { return h_ij + size_t(k) * nSum; }
+        // The packed matrix of the response factors at time k: h_ij itself for storage_mode = 1, or filled into
+        // buffer (nSum values) for storage_mode = 0. The compressed response factors (storage_mode = 2) are only
+        // applied through hMatrix->multiply, which is why they require the iterative solver
+        const double* time_slice(int k, double *buffer);
+        // Appends the response factors of later time values (of the same segments in the same storage mode);
+        // later is left empty
+        void append(SegmentResponse &later);
+        // Uses a buffer held elsewhere (e.g. a memory map) as h_ij, released along with owner
+        void adopt(double *h, std::shared_ptr<void> owner);
+        // Indexes the response factors that are not 0 (nonZero, nonZeroRow, nNonZero), the index is cleared by
+        // append
+        void index_nonzeros();
+        // Stores the differences of consecutive time slices (dh_ij, storage_mode = 0 or 1), cleared by append
+        void difference_slices();
+        // The packed matrix h(k) - h(k - 1), set by difference_slices
+        const double* dh_slice(const int k) const { return dh_ij.data() + size_t(k) * nSum; }
+
 //        void ReSizeContainers(int n, int nt);
         void get_h_value(double &h, int i, int j, int k);
         void get_index_value(int &index, int i, int j);
+
+    private:
+        std::shared_ptr<void> buffer;  // owns h_ij
+        void _allocate();
+        // the response factor of an index at time k (storage_mode = 0)
+        double _similarity_value(int index, int k) const {
+            double h = 0;
+            for (int kind=0; kind<2; kind++) {
+                int ref = simOf[2 * size_t(index) + kind];
+                if (ref >= 0) {
+                    int s = ref >> 1;
+                    double h_s = hSim[size_t(s) * nt + k];
+                    h += ref & 1 ? h_s : ratioSim[s] * h_s;
+                }
+            }  // next kind
+            return h;
+        }  // _similarity_value();
     };  // struct SegmentResponse();
 
+    // vectorize=true evaluates the integrand with the SIMD evaluator of FLSIntegrand (fls_integrand.h)
     double finite_line_source(double time_, double alpha, gt::boreholes::Borehole& b1, gt::boreholes::Borehole& b2,
-            bool reaSource=true, bool imgSource=true);
-    void thermal_response_factors(SegmentResponse &SegRes, std::vector< std::vector< std::vector<double> > >& h_ij,
-            std::vector<gt::boreholes::Borehole>& boreSegments, std::vector<double>& time,
-            double alpha, bool use_similaries, bool disp=false);
+            bool reaSource=true, bool imgSource=true, bool vectorize=false);
+    // Evaluates the FLS solution at every time value with a single pass over the integration domain; the integral
+    // from the lower bound of the shortest time to infinity is accumulated with the integrals between consecutive
+    // lower bounds, h[k] = h[k-1] + integral(a_k, a_k-1)
+    void finite_line_source(vector<double> &h, vector<double> &time, double alpha, gt::boreholes::Borehole& b1,
+            gt::boreholes::Borehole& b2, bool reaSource=true, bool imgSource=true, bool vectorize=false);
+    // The horizontal distance beyond which the FLS solution of any pair of segments is below tol at time_. The
+    // solution is bounded by the infinite line source, 0.5 * E1(r^2 / (4 alpha t)), and the distance grows with time,
+    // so a pair is pruned at a leading run of the time values.
+    double prune_distance(double time_, double alpha, double tol);
+    // At most n_Threads tasks are run at the same time (n_Threads <= 0 uses every thread of the executor)
+    void thermal_response_factors(SegmentResponse &SegRes, std::vector<gt::boreholes::Borehole>& boreSegments, std::vector<double>& time,
+            double alpha, bool use_similaries, bool disp=false,
+            const gt::options::Options &options=gt::options::Options(), int n_Threads=0);
 
 } } // namespace gt::heat_transfer
 
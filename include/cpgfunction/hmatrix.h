@@ -0,0 +1,85 @@
+#ifndef CPGFUNCTION_HMATRIX_H
+#define CPGFUNCTION_HMATRIX_H
+
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+#include <cpgfunction/boreholes.h>
+#include <cpgfunction/executor.h>
+
+namespace gt { namespace heat_transfer {
+
+    // A hierarchical (H-matrix) representation of the symmetric matrices S_k (k = 0, ..., nt - 1) of the segment
+    // to segment response factors, S_k(i, j) being the packed response factor of the pair (min(i, j), max(i, j)) at
+    // time k. The segments are clustered by bisection of their bounding boxes (x, y and the depth span) down to
+    // clusters of at most leaf_size segments. A block of two clusters is admissible, and approximated by a low rank
+    // product U V^T built by adaptive cross approximation (ACA) with partial pivoting, when the smaller of the two
+    // cluster diameters is at most eta times the distance between the clusters; the other blocks are stored dense.
+    // The cross approximation of each block at each time is stopped when the last cross is smaller than tol times
+    // the (estimated) Frobenius norm of the block, or when its entries are smaller than tol times the largest
+    // response factor of that time; it is replaced by the dense block when it would not be smaller.
+    // Only the blocks on and above the block diagonal are stored, the others being their transposes.
+    class HMatrix {
+    public:
+        // entry(i, j, k) returns S_k(i, j), it is only called with i <= j
+        typedef std::function<double(int, int, int)> Entry;
+
+        // The blocks are approximated concurrently on pool (serially when nullptr)
+        HMatrix(std::vector<gt::boreholes::Borehole> &boreSegments, int nt, const Entry &entry, double tol=1.0e-6,
+                double eta=2.0, int leaf_size=16, gt::parallel::TaskGroup *pool=nullptr); // constructor
+        ~HMatrix() {} // destructor
+
+        int nSources;
+        int nt;
+
+        // S_k(i, j)
+        double value(int i, int j, int k) const;
+        // y = y + alpha * S_k * x
+        void multiply(int k, double alpha, const double *x, double *y) const;
+        // Appends the matrices of later time values (of the same segments, tolerance and clusters)
+        void append(HMatrix &later);
+
+        size_t bytes() const;  // memory of the blocks
+        int nBlocks() const { return int(blocks.size()); }
+        int nLowRank() const;  // number of admissible blocks
+        double meanRank() const;  // mean rank of the admissible blocks over every time
+
+    private:
+        struct Cluster {
+            int begin;  // the segments perm[begin], ..., perm[end - 1]
+            int end;
+            double lo[3];  // bounding box of x, y and depth
+            double hi[3];
+            int child[2];  // -1 for a leaf
+        };
+        struct Block {
+            int row;  // clusters
+            int col;
+            bool admissible;
+            std::vector<int> rank;  // rank of each time, -1 when the block is dense at that time
+            std::vector<size_t> offset;  // nt + 1 offsets into data
+            std::vector<double> data;  // dense (row-major) or U (rank x rows) then V (rank x columns) at each time
+        };
+
+        double tol;
+        double eta;
+        int leaf_size;
+        std::vector<int> perm;  // the segments in cluster order
+        std::vector<int> position;  // the position of each segment in perm
+        std::vector<Cluster> clusters;  // the root first
+        std::vector<int> leafOf;  // the leaf cluster of each segment
+        std::vector<int> leaves;  // the leaf clusters
+        std::vector<int> leafIndex;  // the index of each leaf cluster in leaves, -1 for the others
+        std::vector<Block> blocks;
+        // the blocks of the row of each leaf, (the position their columns begin at, b), -1 - b for the transpose of b
+        std::vector<std::vector<std::pair<int, int> > > leafBlocks;
+
+        int _cluster(std::vector<gt::boreholes::Borehole> &boreSegments, int begin, int end);
+        void _partition(int row, int col);
+        void _approximate(Block &block, const Entry &entry, const std::vector<double> &scale);
+    };  // class HMatrix
+
+} } // namespace gt::heat_transfer
+
+#endif //CPGFUNCTION_HMATRIX_H
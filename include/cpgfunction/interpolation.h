@@ -16,8 +16,9 @@ namespace jcc { namespace interpolation {
     double linterp(double xp, double x0, double y0, double x1, double y1);
     void interp1d(vector<double>& xp, vector<double>& yp, vector<double>& x, vector<double>& y);
     void interp1d(double &xp, double &yp, vector<double>& x, vector<double>& y);
-    void interp1d(double &xp, double &yp, vector<double> &time,
-                  gt::heat_transfer::SegmentResponse &SegRes, int &i, int &j, int &k);
+    // The response factors at xp as the blend w0 * h(k) + w1 * h(k + 1) of two time slices, the same for every pair
+    // of segments; w1 is 0 when xp is not after the first time value (the blend of 0 and h(0))
+    void interp_weights(double xp, vector<double> &time, int &k, double &w0, double &w1);
 
 } } // jcc::interpolation
 
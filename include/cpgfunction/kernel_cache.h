@@ -0,0 +1,69 @@
+#ifndef CPGFUNCTION_KERNEL_CACHE_H
+#define CPGFUNCTION_KERNEL_CACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <cpgfunction/boreholes.h>
+
+namespace gt { namespace heat_transfer {
+
+    // A cache of evaluated finite line source (FLS) values keyed on the dimensionless groups the solution depends
+    // on. With the length of the receiving segment H2 as the length scale, the real part of the FLS solution is a
+    // function of r/H2, H1/H2, (D2-D1)/H2 and alpha*t/H2^2, and the image part of (D2+D1)/H2 in place of
+    // (D2-D1)/H2. Bore fields that only differ in H, alpha, spacing or burial depth share these groups, so the
+    // values integrated for one field are reused by the next.
+    //
+    // The groups are quantized before hashing: r/H2, H1/H2 and alpha*t/H2^2 to a relative resolution of
+    // rel_quantum, the depth offsets to an absolute resolution of rel_quantum (in units of H2). When a capacity is
+    // given, the cache is emptied each time it is full.
+    class FLSKernelCache {
+    public:
+        explicit FLSKernelCache(double rel_quantum=1.0e-9, size_t capacity=0); // constructor (0: no capacity)
+        ~FLSKernelCache() {} // destructor
+
+        // The capacity of the caches shared by many fields: the process-wide cache and the cache of a batch
+        static const size_t shared_capacity = size_t(1) << 22;
+
+        // The process-wide cache, of capacity shared_capacity so that it does not grow without bound in a
+        // long-running process
+        static FLSKernelCache& instance();
+
+        // Finds h(t) for every time value. found[k] is true (and h[k] set) when the value is cached.
+        // Returns the number of values found.
+        int find(std::vector<double> &h, std::vector<bool> &found, std::vector<double> &time, double alpha,
+                 gt::boreholes::Borehole &b1, gt::boreholes::Borehole &b2, bool reaSource, bool imgSource);
+        // Stores h[k] = h(time[k]) for the values where found[k] is false
+        void insert(std::vector<double> &h, std::vector<bool> &found, std::vector<double> &time, double alpha,
+                    gt::boreholes::Borehole &b1, gt::boreholes::Borehole &b2, bool reaSource, bool imgSource);
+
+        long hits() const { return nHits; }  // number of values found
+        long misses() const { return nMisses; }  // number of values looked up but not found
+        size_t size();  // number of values stored
+        void clear();  // remove all values and reset the statistics
+
+    private:
+        struct Key {
+            int64_t q[6];  // kind, r/H2, H1/H2, (D2-D1)/H2, (D2+D1)/H2, alpha*t/H2^2
+            bool operator==(const Key &other) const;
+        };
+        struct KeyHash {
+            size_t operator()(const Key &key) const;
+        };
+
+        double rel_quantum;
+        size_t capacity;
+        std::mutex mtx;
+        std::unordered_map<Key, double, KeyHash> values;
+        std::atomic<long> nHits;
+        std::atomic<long> nMisses;
+
+        void _keys(std::vector<Key> &keys, std::vector<double> &time, double alpha, gt::boreholes::Borehole &b1,
+                   gt::boreholes::Borehole &b2, bool reaSource, bool imgSource);
+    };  // class FLSKernelCache
+
+} } // namespace gt::heat_transfer
+
+#endif //CPGFUNCTION_KERNEL_CACHE_H
@@ -0,0 +1,97 @@
+#ifndef CPGFUNCTION_OPTIONS_H
+#define CPGFUNCTION_OPTIONS_H
+
+#include <string>
+
+namespace gt { namespace heat_transfer { class FLSKernelCache; } }
+namespace gt { namespace parallel { class Executor; } }
+
+namespace gt {
+    namespace options {
+
+        // Settings that select between the computational paths of the g-function calculation. The defaults
+        // reproduce the reference g-functions found in test/validation/ exactly; every alternative path is opt-in.
+        struct Options {
+            ~Options() {} // destructor
+
+            // Integrate the finite line source once per segment pair over the whole (sorted) time vector, only
+            // integrating between consecutive lower bounds, rather than once per time value
+            bool fls_time_batch = false;
+            // Evaluate the FLS integrand for all of the quadrature nodes of an interval at once with the SIMD
+            // evaluator selected at runtime (AVX-512 or AVX2), see fls_integrand.h
+            bool fls_vectorize = false;
+            // Look up (and store) the FLS values in a cache keyed on the dimensionless groups of each segment pair,
+            // so that fields differing only in H, alpha or spacing reuse each other's values. Not owned; pass
+            // &gt::heat_transfer::FLSKernelCache::instance() to share values across the whole process (it is emptied
+            // each time it holds FLSKernelCache::shared_capacity values).
+            gt::heat_transfer::FLSKernelCache *fls_cache = nullptr;
+            // Directory of the on-disk response factor store (see response_store.h). The response factors of a
+            // field already in the store are read back instead of being integrated again, and new ones are
+            // written to it. An empty string disables the store.
+            std::string response_store;
+            // The storage of the segment response factors (SegmentResponse::storage_mode): 1 stores every packed
+            // pair at every time, 0 stores one curve per similarity and the similarity of each pair, which takes far
+            // less memory for regular fields, 2 stores the time slices as an H-matrix (see hmatrix.h) whose
+            // admissible blocks are low rank approximations within hmatrix_tol, which takes less memory than either
+            // for large fields (0 and 2 require use_similarities; 2 is best used with similarity_stream). The
+            // H-matrix is only applied through its products, never as dense time slices, so 2 requires
+            // iterative_solver and segments of equal lengths
+            int storage_mode = 1;
+            // The relative tolerance of the low rank blocks of storage_mode 2
+            double hmatrix_tol = 1.0e-6;
+            // Classify the segment pairs on the fly (see boreholes.h, SimilarityStream) rather than listing the pairs
+            // of every similarity, so that the memory of the similarities does not grow with the number of pairs;
+            // the response factors are the same (requires use_similarities)
+            bool similarity_stream = false;
+            // Solve the system of equations for one segment of each orbit of the symmetries of the field (see
+            // boreholes.h, symmetry_group), the segments mapped onto each other by a symmetry having the same heat
+            // extraction rate; the system is smaller by the order of the symmetry group
+            bool symmetry_reduction = false;
+            // Do not integrate the FLS solution of the segment pairs whose response is certain to be below
+            // fls_prune_tol (see heat_transfer.h, prune_distance), which are the distant pairs at early times; their
+            // response factors are 0 and the temporal superposition only goes over the ones that are not. 0 disables
+            // the pruning.
+            double fls_prune_tol = 0.;
+            // Keep the LU factorizations of the system of equations of up to factorization_cache distinct time steps
+            // and solve with them again (dgetrs) when a time step repeats, rather than filling and factorizing the
+            // system again, as with the uniform time values of time_geometric (when tmax <= Nt * dt). The system only
+            // depends on the time step. 0 disables the cache.
+            int factorization_cache = 0;
+            // The memory (MB) the differences of consecutive time slices of the response factors may take. When
+            // they fit, they are stored once next to the response factors (SegmentResponse::difference_slices) and
+            // the temporal superposition reads them; otherwise each time step forms them again from two slices.
+            // 0 always forms them again.
+            double difference_slices_memory = 0.;
+            // Superpose the loads of blocks of superposition_block time steps that are known at the first step of
+            // the block together (see gfunction.h, _far_superposition), each time slice being read once for the steps
+            // of the block rather than once per step; only the recent loads are superposed step by step. The blocks
+            // gain the most on uniform time steps, where all but the last superposition_block loads are known.
+            // 0 or 1 superposes each step on its own.
+            int superposition_block = 0;
+            // Aggregate the reconstructed load history in the temporal superposition: the loads of consecutive times
+            // that differ by no more than superposition_tol times the largest load are superposed as their mean, with
+            // one product with the response factors per block of times rather than one per time. The error of the
+            // borehole wall temperatures is about superposition_tol times the g-function. 0 superposes every time.
+            double superposition_tol = 0.;
+            // Fill and factorize only the segment block of the system of equations, which is symmetric once each row
+            // is scaled by the length of its segments, packed (the lower triangle, dsptrf) with a symmetric
+            // indefinite (Bunch-Kaufman LDL^T) factorization; the border of the borehole wall temperature is solved
+            // for by its Schur complement. The memory of the system and the flops of its factorization are halved.
+            bool packed_solver = false;
+            // Solve the system of equations of each time step with GMRES (see solvers.h) rather than with an LU
+            // decomposition. The system is applied through the response factors and never filled, so the
+            // (nSources + 1)^2 matrix is not stored. The solve is warm-started from the previous time step and
+            // preconditioned by the diagonal, the border of the borehole wall temperature being eliminated exactly.
+            bool iterative_solver = false;
+            // The relative residual the iterative solver converges to
+            double iterative_tol = 1.0e-10;
+            // The executor the tasks are run on (see executor.h); nullptr uses the process-wide one. Not owned.
+            gt::parallel::Executor *executor = nullptr;
+
+            Options() {} // constructor
+        };
+
+    }  // namespace options
+}  // namespace gt
+
+#endif //CPGFUNCTION_OPTIONS_H
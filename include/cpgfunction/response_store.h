@@ -0,0 +1,61 @@
+#ifndef CPGFUNCTION_RESPONSE_STORE_H
+#define CPGFUNCTION_RESPONSE_STORE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <cpgfunction/boreholes.h>
+#include <cpgfunction/heat_transfer.h>
+#include <cpgfunction/options.h>
+
+namespace gt { namespace heat_transfer {
+
+    // The settings of the calculation that change the response factors (the way they are integrated, pruned and
+    // shared between similar pairs), which the stored tables are kept apart by
+    struct ResponseSettings {
+        int64_t use_similarities = 0;
+        int64_t fls_time_batch = 0;
+        int64_t fls_vectorize = 0;
+        int64_t fls_cache = 0;  // whether the FLS values are looked up in a kernel cache
+        int64_t storage_mode = 1;
+        double fls_prune_tol = 0.;
+
+        ResponseSettings() {} // constructor
+        ResponseSettings(const gt::options::Options &options, bool use_similarities, int storage_mode); // constructor
+        bool operator==(const ResponseSettings &other) const;
+    };  // struct ResponseSettings
+
+    // An on-disk store of the segment to segment response factors (SegmentResponse::h_ij). Each table is kept in
+    // its own file named after a hash of the segment geometry, alpha, the time vector, the number of segments per
+    // borehole and the settings that change the response factors (ResponseSettings). The inputs are also written to the file and compared on load, so a hash collision or a
+    // truncated file is treated as a miss. Files are written to a temporary file of their own, synced and renamed
+    // into place, so an interrupted run never leaves a partial table behind and tables of the same key can be saved
+    // by several threads at once.
+    //
+    // The response factors are stored in the layout of SegmentResponse::h_ij (time-major, 64 byte aligned), so a
+    // stored table is memory-mapped and used in place without being copied.
+    class ResponseFactorStore {
+    public:
+        explicit ResponseFactorStore(const std::string &directory); // constructor
+        ~ResponseFactorStore() {} // destructor
+
+        // The key of a table
+        static uint64_t key(std::vector<gt::boreholes::Borehole> &boreSegments, std::vector<double> &time,
+                            double alpha, int nSegments, const ResponseSettings &settings);
+        // The file holding the table of a key
+        std::string path(uint64_t key) const;
+
+        // Maps the stored table into SegRes.h_ij; returns false when the table is not stored
+        bool load(SegmentResponse &SegRes, std::vector<gt::boreholes::Borehole> &boreSegments,
+                  std::vector<double> &time, double alpha, int nSegments, const ResponseSettings &settings) const;
+        // Writes SegRes.h_ij to the store
+        void save(SegmentResponse &SegRes, std::vector<gt::boreholes::Borehole> &boreSegments,
+                  std::vector<double> &time, double alpha, int nSegments, const ResponseSettings &settings) const;
+
+    private:
+        std::string directory;
+    };  // class ResponseFactorStore
+
+} } // namespace gt::heat_transfer
+
+#endif //CPGFUNCTION_RESPONSE_STORE_H
@@ -0,0 +1,21 @@
+#ifndef CPGFUNCTION_SOLVERS_H
+#define CPGFUNCTION_SOLVERS_H
+
+#include <functional>
+#include <vector>
+
+namespace gt { namespace solvers {
+
+    // y = Op(x) for vectors of the size of the system
+    typedef std::function<void(const double *x, double *y)> LinearOperator;
+
+    // Restarted GMRES(restart) with right preconditioning, for the systems that are only applied (matrix-free).
+    // x holds the initial guess and is overwritten by the solution, which is reached when the residual is no more
+    // than tol times the norm of b. M applies the inverse of the preconditioner. Returns the number of iterations;
+    // throws std::runtime_error when max_iterations are not enough.
+    int gmres(const LinearOperator &A, const LinearOperator &M, const std::vector<double> &b, std::vector<double> &x,
+              double tol=1.0e-10, int restart=30, int max_iterations=1000);
+
+} } // namespace gt::solvers
+
+#endif //CPGFUNCTION_SOLVERS_H
@@ -3,6 +3,8 @@
 //
 
 #include <cpgfunction/boreholes.h>
+#include <algorithm>
+#include <cstdint>
 
 
 namespace gt {
@@ -13,6 +15,26 @@ namespace gt {
 
     namespace boreholes {
 
+        namespace {
+            // The first group (lowest index) of sorted_dis within rTol of dis, -1 when there is none. A group is
+            // only added when no other group is within disTol of its distance, so only a few groups are compared.
+            int _find_distance(const multimap<double, int> &sorted_dis, const double dis, const double rTol) {
+                int k_found = -1;
+                for (auto it = sorted_dis.lower_bound(dis - 2 * rTol);
+                     it != sorted_dis.end() && it->first <= dis + 2 * rTol; ++it) {
+                    if (abs(it->first - dis) < rTol && (k_found < 0 || it->second < k_found)) {
+                        k_found = it->second;
+                    }
+                }
+                return k_found;
+            }  // _find_distance();
+
+            double _distance_tolerance(vector<Borehole> &boreSegments, const int i, const int j, const double disTol) {
+                // the relative tolerance is ued for same-borehole distances
+                return i == j ? 1.0e-6 * boreSegments[i].r_b : disTol;
+            }  // _distance_tolerance();
+        }  // namespace
+
         double Borehole::distance(Borehole target) {
             double x1 = x;
             double y1 = y;
@@ -43,17 +65,321 @@ namespace gt {
             return bores;
         }  // boreField();
 
+        SimilarityClasses::SimilarityClasses(const string &kind, const double tol) : tol(tol) {
+            if (kind == "real") {
+                this->kind = 0;
+            } else if (kind == "image") {
+                this->kind = 1;
+            } else if (kind == "realandimage") {
+                this->kind = 2;
+            } else {
+                throw invalid_argument("Error kind not implemented yet.");
+            }
+        }  // SimilarityClasses::SimilarityClasses();
+
+        bool SimilarityClasses::Key::operator==(const Key &other) const {
+            return std::equal(q, q + 6, other.q);
+        }  // SimilarityClasses::Key::operator==();
+
+        size_t SimilarityClasses::KeyHash::operator()(const Key &key) const {
+            // FNV-1a over the cell
+            uint64_t hash = 14695981039346656037ULL;
+            for (int64_t v : key.q) {
+                hash ^= uint64_t(v);
+                hash *= 1099511628211ULL;
+            }
+            return size_t(hash);
+        }  // SimilarityClasses::KeyHash::operator();
+
+        // Classes are found through a hash index on the quantized (H1, H2, D) of the class. log(H1), log(H2) and
+        // log|D| are quantized to cells of 2 * tol (sign kept apart), twice the tolerance of the comparison, and a
+        // class is indexed in its own cell and in every neighbouring cell, so the cell of a pair holds every class
+        // the pair can match. The lowest matching class is kept, as with a scan over the classes.
+        void SimilarityClasses::_key(Key &key, const double H1, const double H2, const double D1,
+                                     const double D2) const {
+            const double width = 2. * tol;
+            auto _quantize = [&width](int64_t *q, const double d) {
+                q[0] = abs(d) < 1.0e-30 ? 0 : (d > 0 ? 1 : -1);
+                q[1] = q[0] == 0 ? 0 : int64_t(floor(log(abs(d)) / width));
+            };
+            key.q[0] = int64_t(floor(log(H1) / width));
+            key.q[1] = int64_t(floor(log(H2) / width));
+            if (kind == 2) {
+                _quantize(key.q + 2, D1);
+                _quantize(key.q + 4, D2);
+            } else {
+                _quantize(key.q + 2, kind == 0 ? D2 - D1 : D2 + D1);
+                key.q[4] = 0;
+                key.q[5] = 0;
+            }
+        }  // SimilarityClasses::_key();
+
+        int SimilarityClasses::_find(const double H1b, const double H2b, const double D1b, const double D2b) const {
+            Key key;
+            _key(key, H1b, H2b, D1b, D2b);
+            int c_found = size();
+            auto it = cells.find(key);
+            if (it == cells.end()) {
+                return c_found;
+            }
+            for (int c : it->second) {
+                if (c > c_found) {
+                    continue;
+                }
+                const double &H1a = H1[c];
+                const double &H2a = H2[c];
+                const double &D1a = D1[c];
+                const double &D2a = D2[c];
+                bool similarity = abs((H1a - H1b) / H1a) < tol && abs((H2a - H2b) / H2a) < tol;
+                if (kind == 0) {
+                    // Condition for equivalence of the real part of the FLS solution
+                    similarity = similarity && abs(((D2a - D1a) - (D2b - D1b)) / (D2a - D1a + 1e-30)) < tol;
+                } else if (kind == 1) {
+                    // Condition for equivalence of the image part of the FLS solution
+                    similarity = similarity && abs(((D2a + D1a) - (D2b + D1b)) / (D2a + D1a + 1e-30)) < tol;
+                } else {
+                    // Condition for equivalence of the full FLS solution
+                    similarity = similarity && abs((D1a - D1b) / (D1a + 1e-30)) < tol
+                                 && abs((D2a - D2b) / (D2a + 1e-30)) < tol;
+                }
+                if (similarity) {
+                    c_found = c;
+                }
+            }
+            return c_found;
+        }  // SimilarityClasses::_find();
+
+        int SimilarityClasses::match(const Borehole &b1, const Borehole &b2) const {
+            int c = _find(b1.H, b2.H, b1.D, b2.D);
+            int c_reversed = _find(b2.H, b1.H, b2.D, b1.D);
+            if (c < size() && c <= c_reversed) {
+                return c;
+            } else if (c_reversed < size()) {
+                return -1 - c_reversed;
+            }
+            return size();
+        }  // SimilarityClasses::match();
+
+        void SimilarityClasses::add(const Borehole &b1, const Borehole &b2) {
+            int c = size();
+            H1.push_back(b1.H);
+            H2.push_back(b2.H);
+            D1.push_back(b1.D);
+            D2.push_back(b2.D);
+            Key key;
+            _key(key, b1.H, b2.H, b1.D, b2.D);
+            int nShift = kind == 2 ? 81 : 27;
+            for (int n=0; n<nShift; n++) {
+                Key neighbour = key;
+                neighbour.q[0] += n % 3 - 1;
+                neighbour.q[1] += n / 3 % 3 - 1;
+                neighbour.q[3] += n / 9 % 3 - 1;
+                if (kind == 2) {
+                    neighbour.q[5] += n / 27 - 1;
+                }
+                cells[neighbour].push_back(c);
+            }  // next n
+        }  // SimilarityClasses::add();
+
+        SimilarityStream::SimilarityStream(vector<Borehole> &boreSegments, const double disTol, const double tol,
+                                           gt::parallel::TaskGroup *pool) : boreSegments(boreSegments),
+                                           disTol(disTol), tol(tol) {
+            gt::parallel::TaskGroup local_pool;
+            gt::parallel::TaskGroup &group = pool != nullptr ? *pool : local_pool;
+
+            // the pair (0, 0) starts the first distance and its classes
+            _add_group(boreSegments[0].r_b, 0, 0);
+
+            // The pairs are enumerated in the order of Similarity::_similarities_group_by_distance, in blocks of
+            // rows. The pairs of a block are first matched in parallel with the distances and classes found before
+            // the block; a pair found there adds nothing. The pairs left are then matched in order, and add the
+            // distances and classes they are not in, as they would have in _similarities_one_distance.
+            int nb = boreSegments.size();
+            const long block_size = 1L << 22;
+            vector<char> found;
+            vector<long> row_offset;
+            auto _found = [this](const int r, const int j) {
+                double dis;
+                int d = _group(r, j, dis);
+                return d >= 0 && real[d].match(this->boreSegments[r], this->boreSegments[j]) != real[d].size()
+                       && image[d].match(this->boreSegments[r], this->boreSegments[j]) != image[d].size();
+            };
+            int i = 0;
+            while (i < nb) {
+                int i_end = i;
+                row_offset.assign(1, 0);
+                while (i_end < nb && row_offset.back() < block_size) {
+                    row_offset.push_back(row_offset.back() + nb - max(i_end, 1));
+                    i_end++;
+                }
+                found.resize(row_offset.back());
+
+                int nTasks = min(4 * group.concurrency(), i_end - i);
+                for (int t=0; t<nTasks; t++) {
+                    group.run([&found, &row_offset, &_found, nb, i, i_end, nTasks, t] {
+                        for (int r=i+t; r<i_end; r+=nTasks) {
+                            long offset = row_offset[r - i] - max(r, 1);
+                            for (int j=max(r, 1); j<nb; j++) {
+                                found[offset + j] = _found(r, j);
+                            }  // next j
+                        }  // next r
+                    });
+                }  // next t
+                group.wait();
+
+                for (int r=i; r<i_end; r++) {
+                    long offset = row_offset[r - i] - max(r, 1);
+                    for (int j=max(r, 1); j<nb; j++) {
+                        if (found[offset + j]) {
+                            continue;
+                        }
+                        double dis;
+                        int d = _group(r, j, dis);
+                        if (d < 0) {
+                            _add_group(dis, r, j);
+                            continue;
+                        }
+                        if (real[d].match(boreSegments[r], boreSegments[j]) == real[d].size()) {
+                            real[d].add(boreSegments[r], boreSegments[j]);
+                            realFirst[d].push_back(r);
+                            realFirst[d].push_back(j);
+                        }
+                        if (image[d].match(boreSegments[r], boreSegments[j]) == image[d].size()) {
+                            image[d].add(boreSegments[r], boreSegments[j]);
+                            imageFirst[d].push_back(r);
+                            imageFirst[d].push_back(j);
+                        }
+                    }  // next j
+                }  // next r
+                i = i_end;
+            }
+
+            // the similarities, numbered by distance as in Similarity::similarities, each with its first pair
+            auto _similarities = [this](SimilaritiesType &SimT, vector<SimilarityClasses> &classes,
+                                        vector<vector<int32_t>> &first, vector<int> &offset) {
+                int nDis = disPairs.size();
+                offset.assign(nDis + 1, 0);
+                for (int d=0; d<nDis; d++) {
+                    offset[d + 1] = offset[d] + classes[d].size();
+                    SimT.H1Sim.insert(SimT.H1Sim.end(), classes[d].H1.begin(), classes[d].H1.end());
+                    SimT.H2Sim.insert(SimT.H2Sim.end(), classes[d].H2.begin(), classes[d].H2.end());
+                    SimT.D1Sim.insert(SimT.D1Sim.end(), classes[d].D1.begin(), classes[d].D1.end());
+                    SimT.D2Sim.insert(SimT.D2Sim.end(), classes[d].D2.begin(), classes[d].D2.end());
+                    SimT.disSim.insert(SimT.disSim.end(), classes[d].size(), disPairs[d]);
+                    for (int c=0; c<classes[d].size(); c++) {
+                        SimT.iSim.push_back(first[d][2 * c]);
+                        SimT.jSim.push_back(first[d][2 * c + 1]);
+                    }
+                }  // next d
+                SimT.nSim = offset[nDis];
+                SimT.offset.resize(SimT.nSim + 1);
+                for (int s=0; s<=SimT.nSim; s++) {
+                    SimT.offset[s] = s;
+                }
+                vector<vector<int32_t>>().swap(first);
+            };
+            _similarities(SimReal, real, realFirst, realOffset);
+            _similarities(SimImage, image, imageFirst, imageOffset);
+        }  // SimilarityStream::SimilarityStream();
+
+        int SimilarityStream::_group(const int i, const int j, double &dis) const {
+            dis = boreSegments[i].distance(boreSegments[j]);
+            return _find_distance(sorted_dis, dis, _distance_tolerance(boreSegments, i, j, disTol));
+        }  // SimilarityStream::_group();
+
+        void SimilarityStream::_add_group(const double dis, const int i, const int j) {
+            int d = disPairs.size();
+            disPairs.push_back(dis);
+            sorted_dis.insert(make_pair(dis, d));
+            real.emplace_back("real", tol);
+            image.emplace_back("image", tol);
+            real[d].add(boreSegments[i], boreSegments[j]);
+            image[d].add(boreSegments[i], boreSegments[j]);
+            realFirst.push_back(vector<int32_t>{i, j});
+            imageFirst.push_back(vector<int32_t>{i, j});
+        }  // SimilarityStream::_add_group();
+
+        void SimilarityStream::classify(const int i, const int j, int &realSim, int &imageSim) const {
+            double dis;
+            int d = _group(i, j, dis);
+            if (d < 0) {
+                throw invalid_argument("The pair of segments is not of the bore field.");
+            }
+            auto _global = [](const int c, const int offset) {
+                return c >= 0 ? c + offset : c - offset;
+            };
+            realSim = _global(real[d].match(boreSegments[i], boreSegments[j]), realOffset[d]);
+            imageSim = _global(image[d].match(boreSegments[i], boreSegments[j]), imageOffset[d]);
+        }  // SimilarityStream::classify();
+
+        std::vector<std::vector<int>> symmetry_group(std::vector<Borehole> &boreField, const double tol) {
+            int nb = boreField.size();
+            double xc = 0.;
+            double yc = 0.;
+            for (auto &b : boreField) {
+                xc += b.x / double(nb);
+                yc += b.y / double(nb);
+            }
+            // the boreholes sorted by x, so that the borehole at a point is found by a binary search
+            vector<int> sorted(nb);
+            for (int b=0; b<nb; b++) {
+                sorted[b] = b;
+            }
+            sort(sorted.begin(), sorted.end(), [&boreField](const int a, const int b) {
+                return boreField[a].x < boreField[b].x;
+            });
+            auto _at = [&boreField, &sorted, &tol](const double x, const double y) {
+                auto it = lower_bound(sorted.begin(), sorted.end(), x - tol, [&boreField](const int b, const double v) {
+                    return boreField[b].x < v;
+                });
+                for (; it != sorted.end() && boreField[*it].x <= x + tol; ++it) {
+                    if (abs(boreField[*it].y - y) <= tol) {
+                        return *it;
+                    }
+                }
+                return -1;
+            };
+
+            // (dx, dy) -> (a * dx + b * dy, c * dx + d * dy)
+            const int transforms[8][4] = {{1, 0, 0, 1}, {0, -1, 1, 0}, {-1, 0, 0, -1}, {0, 1, -1, 0},
+                                          {1, 0, 0, -1}, {-1, 0, 0, 1}, {0, 1, 1, 0}, {0, -1, -1, 0}};
+            std::vector<std::vector<int>> group;
+            for (auto &T : transforms) {
+                vector<int> permutation(nb);
+                bool symmetric = true;
+                for (int b=0; b<nb && symmetric; b++) {
+                    double dx = boreField[b].x - xc;
+                    double dy = boreField[b].y - yc;
+                    int image = _at(xc + T[0] * dx + T[1] * dy, yc + T[2] * dx + T[3] * dy);
+                    symmetric = image >= 0 && boreField[image].H == boreField[b].H
+                                && boreField[image].D == boreField[b].D && boreField[image].r_b == boreField[b].r_b;
+                    permutation[b] = image;
+                }  // next b
+                if (symmetric) {
+                    group.push_back(permutation);
+                }
+            }
+            return group;
+        }  // symmetry_group();
+
+        size_t SimilaritiesType::bytes() const {
+            return offset.capacity() * sizeof(int64_t) + (iSim.capacity() + jSim.capacity()) * sizeof(int32_t)
+                   + (H1Sim.capacity() + H2Sim.capacity() + D1Sim.capacity() + D2Sim.capacity()
+                      + disSim.capacity()) * sizeof(double);
+        }  // SimilaritiesType::bytes();
+
         void Similarity::similarities(SimilaritiesType &SimReal, SimilaritiesType &SimImage,
                                       vector<gt::boreholes::Borehole> &boreSegments, bool splitRealAndImage,
-                                      double disTol, double tol) {
-            // TODO: fork a pool
+                                      double disTol, double tol, gt::parallel::TaskGroup *pool) {
+            gt::parallel::TaskGroup local_pool;
+            gt::parallel::TaskGroup &group = pool != nullptr ? *pool : local_pool;
 
             // declare the variables local to this function
             int nDis;
             vector<double> disPairs;
             vector<int> nPairs;
             vector< vector < tuple <int, int> > > Pairs;
-            _similarities_group_by_distance(boreSegments, Pairs, nPairs, disPairs, nDis);
+            _similarities_group_by_distance(boreSegments, Pairs, nPairs, disPairs, nDis, disTol, &group);
 
             vector<SimilaritiesType> RealSimT(Pairs.size());
             vector<SimilaritiesType> ImageSimT;
@@ -61,43 +387,69 @@ namespace gt {
             // if real and image parts of the FLS are split, evaluate real and image similarities seperately:
             if (splitRealAndImage) {
                 ImageSimT.resize(Pairs.size());
-                for (int i=0; i<Pairs.size(); i++) {
-                    // TODO: thread both of these
-                    _similarities_one_distance(RealSimT[i],Pairs[i], boreSegments, "real");
-                    _similarities_one_distance(ImageSimT[i],Pairs[i], boreSegments, "image");
+                // each distance and kind is a task, the largest distance groups first so that the last tasks
+                // to finish are short
+                vector<int> order(nDis);
+                for (int i=0; i<nDis; i++) {
+                    order[i] = i;
+                }
+                stable_sort(order.begin(), order.end(), [&nPairs](const int a, const int b) {
+                    return nPairs[a] > nPairs[b];
+                });
+                for (int i : order) {
+                    group.run([this, &RealSimT, &Pairs, &boreSegments, tol, i] {
+                        _similarities_one_distance(RealSimT[i], Pairs[i], boreSegments, "real", tol);
+                    });
+                    group.run([this, &ImageSimT, &Pairs, &boreSegments, tol, i] {
+                        _similarities_one_distance(ImageSimT[i], Pairs[i], boreSegments, "image", tol);
+                    });
                 } // next i
-                int a = 1;
+                group.wait();
             } else {
                 throw invalid_argument("splitRealAndImage == false code not implemented yet.");
             } //
 
-            // TODO: close pool
-            // aggregate all real similarities for all distances
-
-            auto _aggregate = [&nDis, &disPairs](vector<SimilaritiesType> &SimFrom, SimilaritiesType &SimTo) {
-                int nSimtmp;
-                // reserve and insert
-                auto _res_and_ins = [](vector<SimilaritiesType> &SimFrom, SimilaritiesType &SimTo, const int &i) {
-                    // Sim positions
-                    SimTo.Sim.reserve(SimTo.Sim.size() + distance(SimFrom[i].Sim.begin(), SimFrom[i].Sim.end()));
-                    SimTo.Sim.insert(SimTo.Sim.end(), SimFrom[i].Sim.begin(), SimFrom[i].Sim.end());
-                    // H values
-                    SimTo.HSim.reserve(SimTo.HSim.size() + distance(SimFrom[i].HSim.begin(), SimFrom[i].HSim.end()));
-                    SimTo.HSim.insert(SimTo.HSim.end(), SimFrom[i].HSim.begin(), SimFrom[i].HSim.end());
-                    // D Values
-                    SimTo.DSim.reserve(SimTo.DSim.size() + distance(SimFrom[i].DSim.begin(), SimFrom[i].DSim.end()));
-                    SimTo.DSim.insert(SimTo.DSim.end(), SimFrom[i].DSim.begin(), SimFrom[i].DSim.end());
-                };
+            // the pairs are in the similarities, the pairs grouped by distance are not needed anymore
+            vector< vector < tuple <int, int> > >().swap(Pairs);
+
+            // aggregate all similarities for all distances: the offsets of each distance (in similarities and in
+            // pairs) are prefix sums, so the output is sized once and each distance is copied into place
+            auto _aggregate = [&nDis, &disPairs, &group](vector<SimilaritiesType> &SimFrom, SimilaritiesType &SimTo) {
+                vector<int> simOffset(nDis + 1, SimTo.nSim);
+                vector<int64_t> pairOffset(nDis + 1, SimTo.offset[SimTo.nSim]);
                 for (int i=0; i<nDis; i++) {
-                    nSimtmp = SimFrom[i].nSim;
-                    SimTo.nSim += SimFrom[i].nSim;
-                    for (int j = 0; j < nSimtmp; j++) { SimTo.disSim.push_back(disPairs[i]); }
-                    vector<vector<tuple<int, int> > > tmp;
-                    tmp = SimFrom[i].Sim;
-                    _res_and_ins(SimFrom, SimTo, i);
+                    simOffset[i + 1] = simOffset[i] + SimFrom[i].nSim;
+                    pairOffset[i + 1] = pairOffset[i] + SimFrom[i].offset[SimFrom[i].nSim];
                 }
+                SimTo.nSim = simOffset[nDis];
+                SimTo.offset.resize(SimTo.nSim + 1);
+                SimTo.offset[SimTo.nSim] = pairOffset[nDis];
+                SimTo.iSim.resize(pairOffset[nDis]);
+                SimTo.jSim.resize(pairOffset[nDis]);
+                SimTo.H1Sim.resize(SimTo.nSim);
+                SimTo.H2Sim.resize(SimTo.nSim);
+                SimTo.D1Sim.resize(SimTo.nSim);
+                SimTo.D2Sim.resize(SimTo.nSim);
+                SimTo.disSim.resize(SimTo.nSim);
+                for (int i=0; i<nDis; i++) {
+                    group.run([&SimFrom, &SimTo, &simOffset, &pairOffset, &disPairs, i] {
+                        SimilaritiesType &from = SimFrom[i];
+                        int s0 = simOffset[i];
+                        for (int s=0; s<from.nSim; s++) {
+                            SimTo.offset[s0 + s] = pairOffset[i] + from.offset[s];
+                        }
+                        copy(from.iSim.begin(), from.iSim.end(), SimTo.iSim.begin() + pairOffset[i]);
+                        copy(from.jSim.begin(), from.jSim.end(), SimTo.jSim.begin() + pairOffset[i]);
+                        copy(from.H1Sim.begin(), from.H1Sim.end(), SimTo.H1Sim.begin() + s0);
+                        copy(from.H2Sim.begin(), from.H2Sim.end(), SimTo.H2Sim.begin() + s0);
+                        copy(from.D1Sim.begin(), from.D1Sim.end(), SimTo.D1Sim.begin() + s0);
+                        copy(from.D2Sim.begin(), from.D2Sim.end(), SimTo.D2Sim.begin() + s0);
+                        fill(SimTo.disSim.begin() + s0, SimTo.disSim.begin() + simOffset[i + 1], disPairs[i]);
+                        from = SimilaritiesType();
+                    });
+                }  // next i
+                group.wait();
             };
-            // Sim positions
             _aggregate(RealSimT, SimReal);
             if (splitRealAndImage) {
                 _aggregate(ImageSimT, SimImage);
@@ -108,7 +460,10 @@ namespace gt {
 
         void Similarity::_similarities_group_by_distance(vector<gt::boreholes::Borehole> &boreSegments,
                                                          vector< vector < tuple <int, int> > > &Pairs, vector<int> &nPairs, vector<double> &disPairs, int &nDis,
-                                                         double disTol) {
+                                                         double disTol, gt::parallel::TaskGroup *pool) {
+            gt::parallel::TaskGroup local_pool;
+            gt::parallel::TaskGroup &group = pool != nullptr ? *pool : local_pool;
+
             // initialize lists
             nPairs.push_back(1);
             vector< tuple <int, int > > vect_w_tup(1);
@@ -117,126 +472,89 @@ namespace gt {
             disPairs.push_back(boreSegments[0].r_b);
             nDis = 1;
 
+            // The distance of each group sorted, so that the groups within the tolerance of a distance are found by
+            // a binary search
+            multimap<double, int> sorted_dis;
+            sorted_dis.insert(make_pair(disPairs[0], 0));
+            auto _find = [&sorted_dis](const double dis, const double rTol) {
+                return _find_distance(sorted_dis, dis, rTol);
+            };
+            auto _tolerance = [&boreSegments, &disTol](const int i, const int j) {
+                return _distance_tolerance(boreSegments, i, j, disTol);
+            };
+
+            // The rows are taken in blocks. The pairs of a block are first matched in parallel with the groups found
+            // before the block; such a match is final, the groups added later have a higher index. The pairs left
+            // are then matched in order, and add the groups they do not match.
             int nb = boreSegments.size();
-            gt::boreholes::Borehole b1;
-            gt::boreholes::Borehole b2;
-            int i2;
-            double dis;
-            double rTol;
-            double diff;
-            for (int i=0; i<nb; i++) {
-                b1 = boreSegments[i];
-                if (i == 0) {
-                    i2 = i + 1;
-                } else {
-                    i2 = i;
-                } // fi i == 0
-                for (int j = i2; j < nb; j++) {
-                    b2 = boreSegments[j];
-                    // distance between current pairs of boreholes
-                    dis = b1.distance(b2);
-                    if (i == j) {
-                        // the relative tolerance is ued for same-borehole distances
-                        rTol = 1.0e-6 * b1.r_b;
-                    } else {
-                        rTol = disTol;
-                    } // fi i == j
-                    // verify if the current pair should be included in the previously identified similarities
-                    for (int k=0; k<nDis; k++) {
-                        diff = abs(disPairs[k] - dis);
-                        if (diff < rTol) {
-                            Pairs[k].push_back(tuple<int, int> (i, j));
-                            nPairs[k]++;
-                            break;
-                        } // fi disPairs[k] - dis < rTol
-                        // add symmetry to the list if no match was found
-                        if (k == nDis-1) {
-                            nDis++;
-                            disPairs.push_back(dis);
-                            vect_w_tup[0] = tuple<int, int> (i, j);
-                            Pairs.push_back(vect_w_tup);
-                            nPairs.push_back(1);
-                            break;
+            const long block_size = 1L << 22;
+            vector<int> match;
+            vector<long> row_offset;
+            int i = 0;
+            while (i < nb) {
+                int i_end = i;
+                row_offset.assign(1, 0);
+                while (i_end < nb && row_offset.back() < block_size) {
+                    row_offset.push_back(row_offset.back() + nb - max(i_end, 1));
+                    i_end++;
+                }
+                match.resize(row_offset.back());
+
+                int nTasks = min(4 * group.concurrency(), i_end - i);
+                for (int t=0; t<nTasks; t++) {
+                    group.run([&boreSegments, &match, &row_offset, &_find, &_tolerance, nb, i, i_end, nTasks, t] {
+                        for (int r=i+t; r<i_end; r+=nTasks) {
+                            long offset = row_offset[r - i] - max(r, 1);
+                            for (int j=max(r, 1); j<nb; j++) {
+                                double dis = boreSegments[r].distance(boreSegments[j]);
+                                match[offset + j] = _find(dis, _tolerance(r, j));
+                            }  // next j
+                        }  // next r
+                    });
+                }  // next t
+                group.wait();
+
+                for (int r=i; r<i_end; r++) {
+                    long offset = row_offset[r - i] - max(r, 1);
+                    for (int j=max(r, 1); j<nb; j++) {
+                        int k = match[offset + j];
+                        if (k < 0) {
+                            double dis = boreSegments[r].distance(boreSegments[j]);
+                            k = _find(dis, _tolerance(r, j));
+                            // add the distance to the list if no match was found
+                            if (k < 0) {
+                                k = nDis;
+                                nDis++;
+                                disPairs.push_back(dis);
+                                Pairs.emplace_back();
+                                nPairs.push_back(0);
+                                sorted_dis.insert(make_pair(dis, k));
+                            }
                         }
-                    } // next k
-                } // for j in range(i2, nb)
-            } // for i in range(nb)
-            int a = 1;
+                        Pairs[k].push_back(tuple<int, int> (r, j));
+                        nPairs[k]++;
+                    }  // next j
+                }  // next r
+                i = i_end;
+            }
         } // Similarity::_similarities_group_by_distance
 
         void Similarity::_similarities_one_distance(SimilaritiesType & SimT, vector<tuple<int, int>> &pairs,
                                                     vector<gt::boreholes::Borehole> &boreSegments, const string& kind,
                                                     double tol) {
-            // Condition for equivalence of the real part of the FLS solution
-            auto compare_real_segments = [](const double &H1a, const double &H1b, const double &H2a, const double &H2b,
-                                            const double &D1a, const double &D1b, const double &D2a, const double &D2b,
-                                            const double &tol){
-                bool similarity;
-                similarity = abs((H1a - H1b) / H1a) < tol && abs((H2a - H2b) / H2a) < tol &&
-                             abs(((D2a - D1a) - (D2b - D1b)) / (D2a - D1a + 1e-30)) < tol;
-                return similarity;
-            };
-            // Condition for equivalence of the image part of the FLS solution
-            auto compare_image_segments = [](const double &H1a, const double &H1b, const double &H2a, const double &H2b,
-                                             const double &D1a, const double &D1b, const double &D2a, const double &D2b,
-                                             const double &tol) {
-                bool similarity;
-                similarity = abs((H1a - H1b) / H1a) < tol && abs((H2a - H2b) / H2a) < tol &&
-                             abs(((D2a + D1a) - (D2b + D1b)) / (D2a + D1a + 1e-30)) < tol;
-                return similarity;
-            };
-            // Condition for equivalence of the full FLS solution
-            auto compare_realandimage_segments = [](const double &H1a, const double &H1b, const double &H2a, const double &H2b,
-                                                    const double &D1a, const double &D1b, const double &D2a, const double &D2b,
-                                                    const double &tol) {
-                bool similarity;
-                similarity = abs((H1a - H1b) / H1a) < tol && abs((H2a - H2b) / H2a) < tol &&
-                             abs((D1a - D1b) / (D1a + 1e-30)) < tol && abs((D2a - D2b) / (D2a + 1e-30)) < tol;
-                return similarity;
-            };
-
-            string real("real");
-            string image("image");
-            string realandimage("realandimage");
+            SimilarityClasses classes(kind, tol);
 
-            // compare segments is a pointer to one of the lambda functions
-            bool(*compare_segments)(const double&, const double&, const double&, const double&,
-                                    const double&, const double&, const double&, const double&, const double&);
-
-            if (real.compare(kind) == 0) {
-                compare_segments = compare_real_segments;
-            } else if (image.compare(kind) == 0) {
-                compare_segments = compare_image_segments;
-            } else if (realandimage.compare(kind) == 0) {
-                compare_segments = compare_realandimage_segments;
-            } else {
-                throw invalid_argument("Error kind not implemented yet.");
-            }
-
-            SimT.nSim = 1;
-            tuple<double, double> doub_tup_temp_H;
-            tuple<double, double> doub_tup_temp_D;
-            tuple<int, int> int_tup_temp_sim;
-            vector< tuple <int, int > > vect_w_tup(1);
-            vect_w_tup[0] = pairs[0];
-//        tuple<int, int> pair0 = pairs[0];
+            // the similarity of each pair, negative (-1 - s) when the pair is reversed; the pairs are then sorted
+            // by similarity in the compressed sparse row layout
+            vector<int> simOfPair(pairs.size());
             int i0 = get<0>(pairs[0]);
             int j0 = get<1>(pairs[0]);
-            SimT.Sim.push_back(vect_w_tup);
-            doub_tup_temp_H = make_tuple(boreSegments[i0].H, boreSegments[j0].H);
-            SimT.HSim.push_back(doub_tup_temp_H);
-            doub_tup_temp_D = make_tuple(boreSegments[i0].D, boreSegments[j0].D);
-            SimT.DSim.push_back(doub_tup_temp_D);
+            classes.add(boreSegments[i0], boreSegments[j0]);
+            simOfPair[0] = 0;
 
             // values used in loops
             int ibor;
             int jbor;
-            gt::boreholes::Borehole b1;
-            gt::boreholes::Borehole b2;
-            double H1;
-            double H2;
-            double D1;
-            double D2;
 
             // Cycle through all pairs of boreholes for the given distance
             for (int i=1; i<pairs.size(); i++) {
@@ -245,35 +563,45 @@ namespace gt {
                 if (ibor > jbor) {
                     swap(ibor, jbor);
                 }
-                b1 = boreSegments[ibor];
-                b2 = boreSegments[jbor];
                 // Verify if the current pair should be included in the previously identified symmetries
-                for (int j=0; j<SimT.nSim; j++) {
-                    H1 = get<0>(SimT.HSim[j]);
-                    H2 = get<1>(SimT.HSim[j]);
-                    D1 = get<0>(SimT.DSim[j]);
-                    D2 = get<1>(SimT.DSim[j]);
-                    if (compare_segments(H1, b1.H, H2, b2.H, D1, b1.D, D2, b2.D, tol)) {
-                        int_tup_temp_sim = make_tuple(ibor, jbor);
-                        SimT.Sim[j].push_back(int_tup_temp_sim);
-                        break;
-                    } else if (compare_segments(H1, b2.H, H2, b1.H, D1, b2.D, D2, b1.D, tol)) {
-                        int_tup_temp_sim = make_tuple(jbor, ibor);
-                        SimT.Sim[j].push_back(int_tup_temp_sim);
-                        break;
-                    } else if (j == SimT.nSim-1) {
-                        SimT.nSim++;
-                        int_tup_temp_sim = make_tuple(ibor, jbor);
-                        vect_w_tup[0] = int_tup_temp_sim;
-                        SimT.Sim.push_back(vect_w_tup);
-                        doub_tup_temp_H = make_tuple(b1.H, b2.H);
-                        SimT.HSim.push_back(doub_tup_temp_H);
-                        doub_tup_temp_D = make_tuple(b1.D, b2.D);
-                        SimT.DSim.push_back(doub_tup_temp_D);
-                        break;
-                    }
-                } // next j
+                int c = classes.match(boreSegments[ibor], boreSegments[jbor]);
+                if (c == classes.size()) {
+                    classes.add(boreSegments[ibor], boreSegments[jbor]);
+                }
+                simOfPair[i] = c;
             } // next i
+            SimT.nSim = classes.size();
+            SimT.H1Sim = std::move(classes.H1);
+            SimT.H2Sim = std::move(classes.H2);
+            SimT.D1Sim = std::move(classes.D1);
+            SimT.D2Sim = std::move(classes.D2);
+
+            // count the pairs of each similarity, then place them in order
+            SimT.offset.assign(SimT.nSim + 1, 0);
+            for (int i=0; i<pairs.size(); i++) {
+                SimT.offset[(simOfPair[i] < 0 ? -1 - simOfPair[i] : simOfPair[i]) + 1]++;
+            }
+            for (int c=0; c<SimT.nSim; c++) {
+                SimT.offset[c + 1] += SimT.offset[c];
+            }
+            vector<int64_t> next(SimT.offset.begin(), SimT.offset.end() - 1);
+            SimT.iSim.resize(pairs.size());
+            SimT.jSim.resize(pairs.size());
+            for (int i=0; i<pairs.size(); i++) {
+                ibor = get<0>(pairs[i]);
+                jbor = get<1>(pairs[i]);
+                if (i > 0 && ibor > jbor) {
+                    swap(ibor, jbor);
+                }
+                int c = simOfPair[i];
+                if (c < 0) {
+                    c = -1 - c;
+                    swap(ibor, jbor);
+                }
+                int64_t k = next[c]++;
+                SimT.iSim[k] = ibor;
+                SimT.jSim[k] = jbor;
+            }  // next i
         }  // Similarity::_similarities_one_distance
 
     } // namespace boreholes
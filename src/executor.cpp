@@ -0,0 +1,131 @@
+#include <cpgfunction/executor.h>
+#include <algorithm>
+
+namespace gt { namespace parallel {
+
+    Executor::Executor(int nWorkers) {
+        if (nWorkers < 0) {
+            // may return 0 when not able to detect
+            nWorkers = std::max(int(std::thread::hardware_concurrency()) - 1, 0);
+        }
+        for (int i=0; i<nWorkers; i++) {
+            workers.emplace_back(&Executor::_work, this);
+        }
+    }  // Executor::Executor();
+
+    Executor::~Executor() {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stopping = true;
+        }
+        cv.notify_all();
+        for (auto &worker : workers) {
+            worker.join();
+        }
+    }  // Executor::~Executor();
+
+    Executor& Executor::instance() {
+        static Executor executor;
+        return executor;
+    }  // Executor::instance();
+
+    void Executor::post(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            tasks.push_back(std::move(task));
+        }
+        cv.notify_one();
+    }  // Executor::post();
+
+    void Executor::_work() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                cv.wait(lock, [this] { return stopping || !tasks.empty(); });
+                if (tasks.empty()) {
+                    return;  // stopping
+                }
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+            task();
+        }
+    }  // Executor::_work();
+
+    TaskGroup::TaskGroup(Executor &executor, const int nThreads) : executor(executor), state(new State) {
+        nRunners = nThreads <= 0 ? executor.size() : std::min(nThreads - 1, executor.size());
+    }  // TaskGroup::TaskGroup();
+
+    TaskGroup::~TaskGroup() {
+        try {
+            wait();
+        } catch (...) {
+            // an exception not collected by wait() is dropped, a destructor cannot throw
+        }
+    }  // TaskGroup::~TaskGroup();
+
+    void TaskGroup::run(std::function<void()> task) {
+        bool post;
+        {
+            std::lock_guard<std::mutex> lock(state->mtx);
+            state->tasks.push_back(std::move(task));
+            state->nPending++;
+            post = state->nActive < nRunners;
+            if (post) {
+                state->nActive++;
+            }
+        }
+        if (post) {
+            std::shared_ptr<State> s = state;
+            executor.post([s] { _drain(s, true); });
+        }
+    }  // TaskGroup::run();
+
+    void TaskGroup::wait() {
+        // the waiting thread takes part, so nested groups always make progress
+        _drain(state, false);
+        std::exception_ptr error;
+        {
+            std::unique_lock<std::mutex> lock(state->mtx);
+            state->cv.wait(lock, [this] { return state->nPending == 0; });
+            std::swap(error, state->error);
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }  // TaskGroup::wait();
+
+    void TaskGroup::_drain(const std::shared_ptr<State> &state, const bool runner) {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::lock_guard<std::mutex> lock(state->mtx);
+                if (state->tasks.empty()) {
+                    if (runner) {
+                        state->nActive--;
+                    }
+                    return;
+                }
+                task = std::move(state->tasks.front());
+                state->tasks.pop_front();
+            }
+            try {
+                task();
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(state->mtx);
+                if (!state->error) {
+                    state->error = std::current_exception();
+                }
+            }
+            {
+                std::lock_guard<std::mutex> lock(state->mtx);
+                state->nPending--;
+                if (state->nPending == 0) {
+                    state->cv.notify_all();
+                }
+            }
+        }
+    }  // TaskGroup::_drain();
+
+} } // namespace gt::parallel
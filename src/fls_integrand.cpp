@@ -0,0 +1,196 @@
+#include <cpgfunction/fls_integrand.h>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+// The vectorized evaluators are written with the GCC/Clang vector extensions and compiled for each instruction set
+// with the target attribute. The vector arguments of the inlined helpers trigger ABI notes that do not apply.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CPGFUNCTION_FLS_SIMD 1
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+namespace gt { namespace heat_transfer {
+
+    FLSIntegrand::FLSIntegrand(gt::boreholes::Borehole &b1, gt::boreholes::Borehole &b2, const bool reaSource,
+                               const bool imgSource) : r(b1.distance(b2)), H2(b2.H) {
+        if (reaSource) {
+            // Real part of the FLS solution
+            d[nTerms] = double(b2.D - b1.D + b2.H); sign[nTerms++] = 1.;
+            d[nTerms] = double(b2.D - b1.D); sign[nTerms++] = -1.;
+            d[nTerms] = double(b2.D - b1.D - b1.H); sign[nTerms++] = 1.;
+            d[nTerms] = double(b2.D - b1.D + b2.H - b1.H); sign[nTerms++] = -1.;
+        } // fi reaSource
+        if (imgSource) {
+            // Image part of the FLS solution
+            d[nTerms] = double(b2.D + b1.D + b2.H); sign[nTerms++] = 1.;
+            d[nTerms] = double(b2.D + b1.D); sign[nTerms++] = -1.;
+            d[nTerms] = double(b2.D + b1.D + b1.H); sign[nTerms++] = 1.;
+            d[nTerms] = double(b2.D + b1.D + b2.H + b1.H); sign[nTerms++] = -1.;
+        } // fi imgSource
+    }  // FLSIntegrand::FLSIntegrand();
+
+    void FLSIntegrand::evaluate_scalar(const double *s, double *f, const int n) const {
+        auto _erfint = [](const double x) {
+            return x * std::erf(x) - (1 / sqrt(M_PI)) * (1 - exp(-pow(x, 2)));
+        };
+        for (int i=0; i<n; i++) {
+            double func = 0.;
+            for (int m=0; m<nTerms; m++) {
+                func += sign[m] * _erfint(d[m] * s[i]);
+            } // next m
+            f[i] = 0.5 / (H2 * pow(s[i], 2)) * func * exp(-pow(r, 2) * pow(s[i], 2));
+        } // next i
+    }  // FLSIntegrand::evaluate_scalar();
+
+#ifdef CPGFUNCTION_FLS_SIMD
+#define FLS_INLINE static inline __attribute__((always_inline))
+
+    template <int W>
+    struct simd {
+        typedef double vd __attribute__((vector_size(W * sizeof(double))));
+        typedef int64_t vi __attribute__((vector_size(W * sizeof(int64_t))));
+    };
+
+    // e^x = 2^n * e^r, with |r| <= ln(2)/2 evaluated by its Taylor series (relative error < 4e-16). Values
+    // below e^-708 are flushed to zero rather than made subnormal.
+    template <class V, class I>
+    FLS_INLINE V _exp(const V x) {
+        const double shift = 6755399441055744.0;  // 1.5 * 2^52, rounds to the nearest integer
+        int64_t shift_bits;
+        std::memcpy(&shift_bits, &shift, sizeof(double));
+        V xc = x < -708. ? V{} - 708. : x;
+        xc = xc > 709. ? V{} + 709. : xc;
+        V t = xc * 1.4426950408889634 + shift;
+        V n = t - shift;
+        V r = xc - n * 6.93147180369123816490e-01 - n * 1.90821492927058770002e-10;
+        V p = V{} + 1. / 479001600.;
+        p = p * r + 1. / 39916800.;
+        p = p * r + 1. / 3628800.;
+        p = p * r + 1. / 362880.;
+        p = p * r + 1. / 40320.;
+        p = p * r + 1. / 5040.;
+        p = p * r + 1. / 720.;
+        p = p * r + 1. / 120.;
+        p = p * r + 1. / 24.;
+        p = p * r + 1. / 6.;
+        p = p * r + 0.5;
+        p = p * r + 1.;
+        p = p * r + 1.;
+        I e = ((I)t - shift_bits + 1023) << 52;  // 2^n
+        V y = p * (V)e;
+        return x < -708. ? V{} : y;
+    }  // _exp();
+
+    // erfint(x) = x * erf(x) - (1 - exp(-x^2)) / sqrt(pi). erf is the rational approximation of the Cephes
+    // library, x * T(x^2) / U(x^2) for |x| < 1 and 1 - exp(-x^2) * P(|x|) / Q(|x|) for 1 <= |x| < 6
+    // (absolute error < 3e-16). Both branches are computed for every lane and blended.
+    template <class V, class I>
+    FLS_INLINE V _erfint(const V x) {
+        V ax = x < 0. ? -x : x;
+        V z = x * x;
+        V e = _exp<V, I>(-z);
+
+        V tn = V{} + 9.60497373987051638749E0;
+        tn = tn * z + 9.00260197203842689217E1;
+        tn = tn * z + 2.23200534594684319226E3;
+        tn = tn * z + 7.00332514112805075473E3;
+        tn = tn * z + 5.55923013010394962768E4;
+        V td = z + 3.35617141647503099647E1;
+        td = td * z + 5.21357949780152679795E2;
+        td = td * z + 4.59432382970980127987E3;
+        td = td * z + 2.26290000613890934246E4;
+        td = td * z + 4.92673942608635921086E4;
+        V erf_small = x * tn / td;
+
+        V xa = ax > 6. ? V{} + 6. : ax;
+        xa = xa < 1. ? V{} + 1. : xa;
+        V pn = V{} + 2.46196981473530512524E-10;
+        pn = pn * xa + 5.64189564831068821977E-1;
+        pn = pn * xa + 7.46321056442269912687E0;
+        pn = pn * xa + 4.86371970985681366614E1;
+        pn = pn * xa + 1.96520832956077098242E2;
+        pn = pn * xa + 5.26445194995477358631E2;
+        pn = pn * xa + 9.34528527171957607540E2;
+        pn = pn * xa + 1.02755188689515710272E3;
+        pn = pn * xa + 5.57535335369399327526E2;
+        V qn = xa + 1.32281951154744992508E1;
+        qn = qn * xa + 8.67072140885989742329E1;
+        qn = qn * xa + 3.54937778887819891062E2;
+        qn = qn * xa + 9.75708501743205489753E2;
+        qn = qn * xa + 1.82390916687909736289E3;
+        qn = qn * xa + 2.24633760818710981792E3;
+        qn = qn * xa + 1.65666309194161350182E3;
+        qn = qn * xa + 5.57535340817727675546E2;
+        V erf_large = 1. - e * pn / qn;
+        erf_large = ax >= 6. ? V{} + 1. : erf_large;
+        erf_large = x < 0. ? -erf_large : erf_large;
+
+        V erf = ax < 1. ? erf_small : erf_large;
+        return x * erf - 0.56418958354775628695 * (1. - e);  // 1 / sqrt(pi)
+    }  // _erfint();
+
+    template <int W>
+    FLS_INLINE void _evaluate(const FLSIntegrand &I_, const double *s, double *f, const int n) {
+        typedef typename simd<W>::vd V;
+        typedef typename simd<W>::vi I;
+        for (int i=0; i<n; i+=W) {
+            int nLanes = n - i < W ? n - i : W;
+            V sv = V{} + 1.;
+            std::memcpy(&sv, s + i, nLanes * sizeof(double));
+            V func = V{};
+            for (int m=0; m<I_.nTerms; m++) {
+                func += I_.sign[m] * _erfint<V, I>(I_.d[m] * sv);
+            } // next m
+            V s2 = sv * sv;
+            V fv = 0.5 / (I_.H2 * s2) * func * _exp<V, I>(-(I_.r * I_.r) * s2);
+            std::memcpy(f + i, &fv, nLanes * sizeof(double));
+        } // next i
+    }  // _evaluate();
+
+    __attribute__((target("avx512f")))
+    static void _evaluate_avx512f(const FLSIntegrand &I_, const double *s, double *f, const int n) {
+        _evaluate<8>(I_, s, f, n);
+    }
+
+    __attribute__((target("avx2,fma")))
+    static void _evaluate_avx2(const FLSIntegrand &I_, const double *s, double *f, const int n) {
+        _evaluate<4>(I_, s, f, n);
+    }
+#endif  // CPGFUNCTION_FLS_SIMD
+
+    static void _evaluate_scalar(const FLSIntegrand &I_, const double *s, double *f, const int n) {
+        I_.evaluate_scalar(s, f, n);
+    }
+
+    typedef void (*_evaluator)(const FLSIntegrand &, const double *, double *, int);
+
+    // CPU feature detection, done once per process
+    static _evaluator _select_evaluator(const char **isa) {
+#ifdef CPGFUNCTION_FLS_SIMD
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) {
+            *isa = "avx512f";
+            return _evaluate_avx512f;
+        }
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+            *isa = "avx2";
+            return _evaluate_avx2;
+        }
+#endif
+        *isa = "scalar";
+        return _evaluate_scalar;
+    }  // _select_evaluator();
+
+    static const char *_isa = "scalar";
+    static const _evaluator _selected = _select_evaluator(&_isa);
+
+    void FLSIntegrand::evaluate(const double *s, double *f, const int n) const {
+        _selected(*this, s, f, n);
+    }  // FLSIntegrand::evaluate();
+
+    const char* fls_integrand_isa() {
+        return _isa;
+    }  // fls_integrand_isa();
+
+} } // namespace gt::heat_transfer
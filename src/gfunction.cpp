@@ -5,10 +5,16 @@
 //
 
 #include <cpgfunction/gfunction.h>
+#include <algorithm>
 #include <chrono>
+#include <mutex>
+#include <stdexcept>
 #include <cpgfunction/interpolation.h>
-#include <thread>
-#include <boost/asio.hpp>
+#include <cpgfunction/response_store.h>
+#include <cpgfunction/executor.h>
+#include <cpgfunction/hmatrix.h>
+#include <cpgfunction/kernel_cache.h>
+#include <cpgfunction/solvers.h>
 
 #include <LinearAlgebra/gesv.h>
 #include <LinearAlgebra/axpy.h>
@@ -19,67 +25,247 @@
 
 extern "C" void dcopy_(int *n, double *x, int *incx, double *y, int *incy);
 extern "C" void daxpy_(int *n, double *a, double *x, int *incx, double *y, int *incy);
+extern "C" void dscal_(int *n, double *a, double *x, int *incx);
+extern "C" void dsymm_(char *side, char *uplo, int *m, int *n, double *alpha, double *A, int *lda, double *B,
+                       int *ldb, double *beta, double *C, int *ldc);
 extern "C" void dspmv_(char *uplo, int *n, double *alpha, double *A,
                        double *x, int *incx, double *beta, double *y, int *incy);
+extern "C" void dgetrf_(int *m, int *n, double *A, int *lda, int *ipiv, int *info);
+extern "C" void dgetrs_(char *trans, int *n, int *nrhs, double *A, int *lda, int *ipiv, double *b, int *ldb,
+                        int *info);
+extern "C" void dsptrf_(char *uplo, int *n, double *AP, int *ipiv, int *info);
+extern "C" void dsptrs_(char *uplo, int *n, int *nrhs, double *AP, int *ipiv, double *b, int *ldb, int *info);
 
 #include <omp.h>
 
 using namespace std;  // lots of vectors, only namespace to be used
 
 namespace gt { namespace gfunction {
+
+    namespace {
+        // Throws when a LAPACK routine did not factorize or solve the system of equations of a time step
+        void _check_info(const int info, const string &routine) {
+            if (info < 0) {
+                throw runtime_error(routine + " was given an illegal value in argument " + to_string(-info) + ".");
+            } else if (info > 0) {
+                throw runtime_error("The system of equations of the time step is singular (" + routine + " info = "
+                                    + to_string(info) + ").");
+            }
+        }  // _check_info();
+
+        // Whether most of the response factors of time k are (pruned to) 0, so that they are applied by
+        // _sparse_symmetric_product rather than to the whole time slice
+        bool _sparse_slice(gt::heat_transfer::SegmentResponse &SegRes, const int k) {
+            return k < SegRes.nNonZero.size() && SegRes.nNonZero[k] < SegRes.nSum / 2;
+        }  // _sparse_slice();
+
+        // Y += S X over the response factors of time k that are not 0, with S = h(k) - h(k-1) when difference is
+        // true and S = h(k) otherwise. X and Y hold m columns of nSources values (column-major)
+        void _sparse_symmetric_product(gt::heat_transfer::SegmentResponse &SegRes, const int k,
+                                       const bool difference, const double *X, const int m, double *Y) {
+            int nSources = SegRes.nSources;
+            const double *h = SegRes.slice(k);
+            const double *h_1 = difference && k > 0 ? SegRes.slice(k-1) : nullptr;
+            for (int n=0; n<SegRes.nNonZero[k]; n++) {
+                int index = SegRes.nonZero[n];
+                int i = SegRes.nonZeroRow[n];
+                int j = index - i * (2 * nSources - i - 1) / 2;
+                double h_ij = h_1 != nullptr ? h[index] - h_1[index] : h[index];
+                for (int c=0; c<m; c++) {
+                    const double *x = X + size_t(c) * nSources;
+                    double *y = Y + size_t(c) * nSources;
+                    y[i] += h_ij * x[j];
+                    if (i != j) {
+                        y[j] += h_ij * x[i];
+                    }
+                }  // next c
+            }  // next n
+        }  // _sparse_symmetric_product();
+    }  // namespace
+
     // The uniform borehole wall temperature (UBWHT) g-function calculation. Originally presented in
     // Cimmino and Bernier (2015) and a later paper on speed improvements by Cimmino (2018)
     vector<double> uniform_borehole_wall_temperature(
             vector<gt::boreholes::Borehole> &boreField,
             vector<double> &time, double alpha, int nSegments,
-            bool use_similarities, bool adaptive, int n_Threads,
-            bool multi_thread, bool display){
-        vector<double> gFunction(time.size());
+            bool use_similarities, bool /* adaptive */, int n_Threads,
+            bool multi_thread, bool display, const gt::options::Options &options){
+        UniformBoreholeWallTemperature gFunction(boreField, alpha, nSegments, use_similarities, n_Threads,
+                                                 multi_thread, display, options);
+        return gFunction.extend(time);
+    }  // uniform_borehole_wall_temperature();
 
-        if (display) {
-            std::cout << "------------------------------------------------------------" << std::endl;
-            std::cout << "Calculating g-function for uniform borehole wall temperature" << std::endl;
-            std::cout << "------------------------------------------------------------" << std::endl;
+    void uniform_borehole_wall_temperature(vector<BoreFieldDefinition> &fields,
+            const std::function<void(int, vector<double>&)> &result, int n_Threads,
+            const gt::options::Options &options) {
+        gt::parallel::Executor &executor = options.executor != nullptr ? *options.executor
+                                                                        : gt::parallel::Executor::instance();
+        // the batch cache is emptied when it holds 2^22 values (a few hundred MB), so a long batch is bounded in memory
+        gt::heat_transfer::FLSKernelCache batch_cache(1.0e-9, gt::heat_transfer::FLSKernelCache::shared_capacity);
+        gt::options::Options field_options = options;
+        if (field_options.fls_cache == nullptr) {
+            field_options.fls_cache = &batch_cache;
         }
-        auto startall = std::chrono::steady_clock::now();
-        // Open up processes here
-        // Create a vector of threads
-        //may return 0 when not able to detect
-        const auto processor_count = thread::hardware_concurrency();
-//        // Launch the pool with n threads.
-//        cout << "\tDetected " << processor_count << " as the number of available threads" << endl;
-
-        // Number of boreholes
-        int nbh = boreField.size();
-        // Total number of line sources
-        int nSources = nSegments * nbh;
-        // Number of time values
-        int nt = time.size();
-
-        auto sum_to_n = [](const int n) {
-            return n * (n + 1) / 2;
-        };
-        int nSum = sum_to_n(nSources);
+        field_options.executor = &executor;
 
-        // Segment Response struct
-        gt::heat_transfer::SegmentResponse SegRes(nSources, nSum, nt);
+        gt::parallel::TaskGroup batch(executor, n_Threads);
+        int nFields = int(fields.size());
+        // the threads of the batch are first spread over the fields, a field only gets more than one when the
+        // batch is smaller than the number of threads
+        int field_threads = max(batch.concurrency() / max(nFields, 1), 1);
+        mutex mtx;
+        for (int i=0; i<nFields; i++) {
+            batch.run([&fields, &result, &field_options, &mtx, field_threads, i] {
+                BoreFieldDefinition &field = fields[i];
+                vector<gt::boreholes::Borehole> boreField = gt::boreholes::boreField(field.coordinates, field.r_b,
+                                                                                     field.H, field.D);
+                vector<double> gFunction = uniform_borehole_wall_temperature(
+                        boreField, field.time, field.alpha, field.nSegments, true, true, field_threads, true,
+                        false, field_options);
+                lock_guard<mutex> lock(mtx);
+                result(i, gFunction);
+            });
+        }  // next i
+        batch.wait();
+    }  // uniform_borehole_wall_temperature();
 
+    UniformBoreholeWallTemperature::UniformBoreholeWallTemperature(vector<gt::boreholes::Borehole> &boreField,
+            double alpha, int nSegments, bool use_similarities, int n_Threads, bool multi_thread, bool display,
+            const gt::options::Options &options) : alpha(alpha), nSegments(nSegments),
+            use_similarities(use_similarities), n_Threads(n_Threads), multi_thread(multi_thread), display(display),
+            options(options), nSources(nSegments * int(boreField.size())),
+            nSum(nSources * (nSources + 1) / 2), SegRes(nSources, nSum, 0, options.storage_mode),
+            boreSegments(nSources), Hb(nSources), Q(nSources) {
+        if (!options.response_store.empty() && SegRes.storage_mode != 1) {
+            throw invalid_argument("The response factor store holds the response factors of storage_mode 1.");
+        }
+        if (SegRes.storage_mode == 2 && !options.iterative_solver) {
+            throw invalid_argument("The compressed response factors (storage_mode 2) are solved for by the "
+                                   "iterative solver.");
+        }
         // Split boreholes into segments
-        vector<gt::boreholes::Borehole> boreSegments(nSources);
         _borehole_segments(boreSegments, boreField, nSegments);
 
         // TODO: make SegRes hold all Segment Response specific stuff
         _borehole_segments(SegRes.boreSegments, boreField, nSegments);
 
-        // Initialize segment-to-segment response factors (https://slaystudy.com/initialize-3d-vector-in-c/)
-        // NOTE: (nt + 1), the first row will be full of zeros for later interpolation
-//        vector< vector< vector<double> > > h_ij(nSources ,
-//                vector< vector<double> > (nSources, vector<double> (nt+1, 0.0)) );
-        vector< vector< vector<double> > > h_ij(1 ,
-                                                vector< vector<double> > (1, vector<double> (1, 0.0)) );
-        // Calculate segment to segment thermal response factors
+        // ------ Segment lengths -------
+        for (int b=0; b<nSources; b++) {
+            Hb[b] = boreSegments[b].H;
+        } // next b
+        Hb_sum = 0;
+        for (auto & _hb : Hb) {
+            Hb_sum += _hb;
+        }
+        if (SegRes.storage_mode == 2) {
+            for (int b=0; b<nSources; b++) {
+                if (Hb[b] != Hb[0]) {
+                    throw invalid_argument("The compressed response factors (storage_mode 2) are applied to segments "
+                                           "of equal lengths.");
+                }
+            }
+        }
+
+        // ------ Segment orbits -------
+        // Each segment is its own orbit unless the symmetries of the field are used
+        vector<vector<int>> symmetries(1, vector<int>(boreField.size()));
+        for (int b=0; b<boreField.size(); b++) {
+            symmetries[0][b] = b;
+        }
+        if (options.symmetry_reduction) {
+            symmetries = gt::boreholes::symmetry_group(boreField);
+        }
+        vector<int> boreholeOrbit(boreField.size(), -1);
+        int nBoreholeOrbits = 0;
+        for (int b=0; b<boreField.size(); b++) {
+            if (boreholeOrbit[b] < 0) {
+                for (auto &permutation : symmetries) {
+                    boreholeOrbit[permutation[b]] = nBoreholeOrbits;
+                }
+                nBoreholeOrbits++;
+            }
+        }  // next b
+        nOrbits = nBoreholeOrbits * nSegments;
+        orbitOf.resize(nSources);
+        orbitRep.assign(nOrbits, -1);
+        for (int i=0; i<nSources; i++) {
+            orbitOf[i] = boreholeOrbit[i / nSegments] * nSegments + i % nSegments;
+            if (orbitRep[orbitOf[i]] < 0) {
+                orbitRep[orbitOf[i]] = i;
+            }
+        }  // next i
+        if (display && options.symmetry_reduction) {
+            std::cout << "Symmetry group of order " << symmetries.size() << ", " << nOrbits << " of " << nSources
+                      << " segment heat extraction rates solved for" << std::endl;
+        }
+    }  // UniformBoreholeWallTemperature::UniformBoreholeWallTemperature();
+
+    vector<double>& UniformBoreholeWallTemperature::extend(vector<double> &time_new) {
+        for (int k=0; k<time_new.size(); k++) {
+            if (time_new[k] <= (k == 0 ? (time.empty() ? 0. : time.back()) : time_new[k-1])) {
+                throw invalid_argument("The time values must be positive and increasing.");
+            }
+        }  // next k
+        if (time_new.empty()) {
+            return gFunction;
+        }
+
+        if (display) {
+            std::cout << "------------------------------------------------------------" << std::endl;
+            std::cout << "Calculating g-function for uniform borehole wall temperature" << std::endl;
+            std::cout << "------------------------------------------------------------" << std::endl;
+        }
+        auto startall = std::chrono::steady_clock::now();
+        // The tasks of every phase are run on the shared executor, at most n_Threads at a time
+        gt::parallel::Executor &executor = options.executor != nullptr ? *options.executor
+                : gt::parallel::Executor::instance();
+
+        // Number of time values already solved
+        int nt_old = time.size();
+        // Number of time values
+        int nt = nt_old + time_new.size();
+
+        // Calculate segment to segment thermal response factors at the new time values only
         auto start = std::chrono::steady_clock::now();
-        gt::heat_transfer::thermal_response_factors(SegRes,h_ij, boreSegments, time, alpha, use_similarities, display);
+        gt::heat_transfer::SegmentResponse SegResNew(nSources, nSum, time_new.size(), SegRes.storage_mode);
+        SegResNew.boreSegments = SegRes.boreSegments;
+        // Read the response factors from the store when they are already there
+        gt::heat_transfer::ResponseFactorStore store(options.response_store);
+        gt::heat_transfer::ResponseSettings settings(options, use_similarities, SegRes.storage_mode);
+        bool stored = !options.response_store.empty() && store.load(SegResNew, boreSegments, time_new, alpha,
+                                                                    nSegments, settings);
+        if (stored) {
+            if (display) {
+                std::cout << "Segment to segment response factors read from the response factor store" << std::endl;
+            }
+        } else {
+            gt::heat_transfer::thermal_response_factors(SegResNew, boreSegments, time_new, alpha, use_similarities,
+                                                         display, options, n_Threads);
+            if (!options.response_store.empty()) {
+                store.save(SegResNew, boreSegments, time_new, alpha, nSegments, settings);
+            }
+        }
+        SegRes.append(SegResNew);
+        if (options.fls_prune_tol > 0 && SegRes.storage_mode == 1) {
+            // the pruned response factors are 0, the early time slices are superposed sparsely
+            SegRes.index_nonzeros();
+            if (display) {
+                std::cout << SegRes.nNonZero[0] << " of " << nSum << " response factors are not pruned at the "
+                          << "first time" << std::endl;
+            }
+        }
+        if (options.difference_slices_memory > 0 && options.superposition_tol <= 0 && SegRes.storage_mode != 2) {
+            // the differences of the time slices are stored once if they fit the memory given to them, otherwise
+            // each time step forms them again
+            double megabytes = double(nSum) * SegRes.nt * sizeof(double) / 1.0e6;
+            if (megabytes <= options.difference_slices_memory) {
+                SegRes.difference_slices();
+            }
+            if (display) {
+                std::cout << "The differences of the time slices (" << megabytes << " MB) are "
+                          << (SegRes.dh_ij.empty() ? "formed at each time step" : "stored") << std::endl;
+            }
+        }
         auto end = std::chrono::steady_clock::now();
 
         if (display) {
@@ -100,85 +286,39 @@ namespace gt { namespace gfunction {
         double fill_A_time = 0;
         double load_history_reconstruction_time = 0;
         double temporal_superposition_time = 0;
-        double fill_gsl_matrices_time = 0;
         double LU_decomposition_time = 0;
 
         auto start2 = std::chrono::steady_clock::now();
-        boost::asio::thread_pool pool(processor_count);
-
-        // ------ Segment lengths -------
-        start = std::chrono::steady_clock::now();
-        std::vector<float> Hb(nSources);
-        auto _segmentlengths = [&boreSegments, &Hb](const int nSources) {
-            for (int b=0; b<nSources; b++) {
-                Hb[b] = boreSegments[b].H;
-            } // next b
-        }; // auto _segmentlengths
-        if (multi_thread) {
-            boost::asio::post(pool, [nSources, &boreSegments, &Hb, &_segmentlengths]{ _segmentlengths(nSources); });
-        } else {
-            _segmentlengths(nSources);
-        }  // if (multi_thread);
-
-        end = std::chrono::steady_clock::now();
-        milli = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
-        segment_length_time += milli;
+        gt::parallel::TaskGroup pool(executor, n_Threads);
 
         // ------ time vectors ---------
         start = std::chrono::steady_clock::now();
+        time.insert(time.end(), time_new.begin(), time_new.end());
         // create new time vector that starts at 0
-        std::vector<double> _time_untouched(time.size()+1);
-        std::vector<double> _time(time.size()+1);
-        std::vector<double> dt(_time_untouched.size());
-
-        auto _fill_time = [&_time, &time, &dt, &_time_untouched]() {
-            for (int i=0; i<_time.size(); i++) {
-                if (i==0) {
-                    _time[0] = 0;
-                    _time_untouched[0] = 0;
-                    dt[i] = time[i];
-                } else {
-                    _time[i] = time[i-1];
-                    _time_untouched[i] = time[i-1];
-                    dt[i] = time[i] - time[i-1];
-                } // fi
-            } // next i
-        }; // auto _fill_time
-        if (multi_thread) {
-            boost::asio::post(pool, [&_fill_time, &time, &_time]{ _fill_time() ;});
-        } else {
-            _fill_time();
-        }  // if (multi_thread);
+        _time_untouched.resize(time.size()+1);
+        _time.resize(time.size()+1);
+        dt.resize(_time_untouched.size());
+        for (int i=0; i<_time.size(); i++) {
+            if (i==0) {
+                _time[0] = 0;
+                _time_untouched[0] = 0;
+                dt[i] = time[i];
+            } else {
+                _time[i] = time[i-1];
+                _time_untouched[i] = time[i-1];
+                dt[i] = time[i] - time[i-1];
+            } // fi
+        } // next i
 
         end = std::chrono::steady_clock::now();
         milli = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
         time_vector_time += milli;
 
-        pool.join(); // starting up a new idea after this, pool will close here
-
-        // ---------- segment h values -------------
-        /** Starting up pool2 here **/
-        // Launch the pool with n threads.
-        auto tic = std::chrono::steady_clock::now();
-//        boost::asio::thread_pool pool2(processor_count);
-        auto toc = std::chrono::steady_clock::now();
-        if (display) {
-            double milli = std::chrono::duration_cast<std::chrono::milliseconds>(tic - toc).count();
-            double seconds = milli;
-            std::cout << "Time to open a pool : "
-                      << seconds
-                      << " sec" << std::endl;
+        // Segment heat extraction rates, kept from the time steps already solved
+        for (auto &Q_i : Q) {
+            Q_i.resize(nt);
         }
-
-        start = std::chrono::steady_clock::now();
-
-        end = std::chrono::steady_clock::now();
-        milli = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
-        segment_h_values_time += milli;
-
-        // after interpolation scheme, get rid of h_ij first
-        // Initialize segment heat extraction rates
-        vector<vector<double> > Q(nSources, vector<double> (nt));
+        gFunction.resize(nt);
 
         // Define A and b for utitilizing Ax=b
         /**
@@ -190,120 +330,135 @@ namespace gt { namespace gfunction {
          *     ]
          * **/
 
-        int SIZE = nSources + 1;
+        // one unknown per orbit of segments (every segment unless the symmetries of the field are used)
+        int SIZE = nOrbits + 1;
         // _gesv initializiation
         int nrhs = 1; // number of columns in the b Matrix
         int lda = SIZE;
         int ldb = SIZE;
         std::vector<int> _ipiv(SIZE);
         int info;
-        vector<double> A_ (SIZE * SIZE);
-        vector<double> b_ (SIZE);
-
-//        std::vector<std::vector <double>> A(nSources +1, std::vector<double> (nSources +1));
-//        std::vector<double> b(nSources + 1);
-
-        // Fill A
-        int n = SIZE - 1;
-        n = b_.size() - 1;
-        double Hb_sum=0;
-        for (auto & _hb : Hb) {
-            Hb_sum += _hb;
+        vector<double> A_ (options.iterative_solver ? 0 : options.packed_solver ? nOrbits * (nOrbits + 1) / 2
+                                                                                 : SIZE * SIZE);
+        // The packed solver: row o scaled by the length of orbit o, H_o, the segment block B is symmetric
+        // (H_i h_ij = H_j h_ji) and the border is -H_o, which the bordered system is solved for by its Schur complement
+        vector<double> H_o(nOrbits, 0.);
+        for (int j=0; j<nSources; j++) {
+            H_o[orbitOf[j]] += Hb[j];
         }
-//        b[n] = Hb_sum;
+        vector<double> uv(options.packed_solver ? 2 * nOrbits : 0);
+        int iterations = 0;  // of the iterative solver
+        vector<double> b_ (SIZE);
+        // the response factors of every pair at the time step, and a time slice read from the similarities or the
+        // H-matrix
+        int nSum = SegRes.nSum;
+        vector<double> h_dt(options.iterative_solver ? 0 : nSum);
+        vector<double> h_buffer(!options.iterative_solver && SegRes.storage_mode == 0 ? nSum : 0);
+        // the superposition of the loads of a block of time steps that are known at its first step, and the first
+        // time of each step that is known (see _far_superposition)
+        bool blocked = options.superposition_block > 1 && options.superposition_tol <= 0 && SegRes.storage_mode != 2;
+        vector<double> Tb_far;
+        vector<int> k_far;
+        // a time slice of the block unpacked to a full matrix, for dsymm
+        vector<double> dh_full(blocked ? size_t(nSources) * nSources : 0);
 
-        // Build and solve the system of equations at all times
+        // Build and solve the system of equations at the new times
 
         // the loop p=n depends on what occured at p=n-1, so this will be be in series
         // however threading will be interspersed throughout to make use of as many threads as possible
-        // TODO: since this is in series, move the variable declarations here
-//        vector<vector<double>> h_ij_dt (nSources, vector<double> (nSources));
         std::vector<double> Tb_0 (nSources);
         // Restructured load history
-        // create interpolation object for accumulated heat extraction
-        std::vector<std::vector<double>> q_reconstructed (nSources, std::vector<double> (nt));
         std::vector<double> q_r(nSources * nt, 0);
 
-        // TODO: Correct the storage of the segment response matrix
-        int gauss_sum = nSources * (nSources + 1) / 2;
-        std::vector<double> H_ij(gauss_sum * nt, 0);  // 1D nSources x nt
-        int idx;
-        for (int i=0; i<nt; i++) {
-            for (int j=0; j<gauss_sum; j++) {
-                idx = (i * gauss_sum) + j;
-                H_ij[idx] = SegRes.h_ij[j][i];
-            }  // next j
-        }  // next i
+        // The response factors are stored time-major (SegRes.slice(k)), as consumed by the temporal superposition
 
-        for (int p=0; p<nt; p++) {
-            if (p==1) {
-                int a = 1;
-            }
-            // current thermal response factor matrix
-//            auto _fill_h_ij_dt = [&h_dt, &A] (const int i, const int p) {
-//                int m = h_dt[0].size();
-//                for (int j=0; j<A[i].size(); j++) {
-//                    if (j==A[i].size()-1) {
-//                        A[i][j] = -1;
-//                    } else {
-//                        A[j][i] = h_dt[i][j][p];
-//                    }
-////                    h_ij_dt[j][i] = h_dt[i][j][p];
-//
-//                } // next j
-//                ;
-//            }; // _fill_h_ij_dt
-            // _fill_A
-            //        auto _fill_A = [&A, &Hb, &_A](const int i, const int SIZE) { // TODO: keep in mind this function can make use of threading
+        for (int p=nt_old; p<nt; p++) {
+            // ------------- cached factorization ------------
+            // A only depends on dt[p], the factorization of an equal time step (within round-off) is used again
+            Factorization *factorization = nullptr;
+            if (options.factorization_cache > 0 && !options.iterative_solver) {
+                auto it = factorizations.lower_bound(dt[p] * (1 - 1.0e-12));
+                if (it != factorizations.end() && it->first <= dt[p] * (1 + 1.0e-12)) {
+                    factorization = &it->second;
+                }
+            }
 
             // ------------- fill A ------------
             start = std::chrono::steady_clock::now();
-            auto _fillA = [&Hb, &A_, &dt, &_time_untouched, &boreSegments, &h_ij, &time, &SegRes](int i, int p, int SIZE) {
-                double xp;
-                double yp;
+            // the response factors at dt[p] are the same blend of the two time slices bounding it for every pair,
+            // formed in one pass over the slices rather than interpolated pair by pair
+            bool fill = factorization == nullptr && !options.iterative_solver;
+            if (fill) {
+                int k;
+                double w0;
+                double w1;
+                int inc = 1;
+                jcc::interpolation::interp_weights(dt[p], time, k, w0, w1);
+                dcopy_(&nSum, const_cast<double *>(SegRes.time_slice(k, h_buffer.data())), &inc, &*h_dt.begin(),
+                       &inc);
+                dscal_(&nSum, &w0, &*h_dt.begin(), &inc);
+                if (w1 != 0) {
+                    daxpy_(&nSum, &w1, const_cast<double *>(SegRes.time_slice(k + 1, h_buffer.data())), &inc,
+                           &*h_dt.begin(), &inc);
+                }
+            }
+            // h(i, j) at dt[p], scaled as get_h_value for i > j
+            auto _h = [this, &h_dt](int i, int j) -> double {
+                int index;
+                if (i <= j) {
+                    SegRes.get_index_value(index, i, j);
+                    return h_dt[index];
+                }
+                SegRes.get_index_value(index, j, i);
+                return Hb[j] / Hb[i] * h_dt[index];
+            };
+            // row o is the equation of the first segment of orbit o, the coefficients of the segments of an orbit
+            // being summed
+            auto _fillA = [this, &A_, &_h](int o, int SIZE) {
                 int n = SIZE - 1;
-                for (int j=0; j<SIZE; j++) {
-                    if (i == n) { // then we are referring to Hb
-                        if (j==n) {
-                            A_[i+j*SIZE] = 0;
-//                            A[i][n] = 0;
-                        } else {
-                            A_[i+j*SIZE] = Hb[j];
-//                            A[i][j] = Hb[j];
-                        } // fi
-                    } else {
-                        if (j==SIZE-1) {
-                            A_[i+j*SIZE] = -1;
-//                            A[i][j] = -1;
-                        } else {
-                            xp = dt[p];
-                            double yp_tmp;
-//                            if (i==0 && j==5 && p==0) {
-//                                int a = 1;
-//                            }
-//                            jcc::interpolation::interp1d(xp, yp, time, h_map, boreSegments, i, j, hash_mode);
-                            jcc::interpolation::interp1d(xp, yp, time, SegRes, i, j, p);
-//                            jcc::interpolation::interp1d(xp, yp, _time_untouched, h_ij[i][j]);
-//                            if (yp - yp_tmp > 1.0e-6) {
-//                                int a = 1;
-//                            }
-                            A_[i+j*SIZE] = yp;
-//                            A_[j+i*SIZE] = h_dt[i][j][p];
-//                            A[i][j] = h_dt[i][j][p];
-                        } // fi
-                    } // fi
-                } // next k
+                for (int c=0; c<SIZE; c++) {
+                    A_[o+c*SIZE] = 0;
+                }
+                if (o == n) { // then we are referring to Hb
+                    for (int j=0; j<nSources; j++) {
+                        A_[o+orbitOf[j]*SIZE] += Hb[j];
+                    }  // next j
+                } else {
+                    int i = orbitRep[o];
+                    for (int j=0; j<nSources; j++) {
+                        A_[o+orbitOf[j]*SIZE] += _h(i, j);
+                    }  // next j
+                    A_[o+n*SIZE] = -1;
+                } // fi
+            };
+            // B packed by columns below the diagonal (dsptrf 'L'), column o being row o of the scaled system
+            // H_o h(rep_o, j) on and after the diagonal, B(o, o') at o * (2 nOrbits - o - 1) / 2 + o'
+            auto _fillB = [this, &A_, &H_o, &_h](int o) {
+                int begin = o * (2 * nOrbits - o - 1) / 2;
+                for (int c=o; c<nOrbits; c++) {
+                    A_[begin + c] = 0;
+                }
+                int i = orbitRep[o];
+                for (int j=0; j<nSources; j++) {
+                    if (orbitOf[j] >= o) {
+                        A_[begin + orbitOf[j]] += H_o[o] * _h(i, j);
+                    }
+                }  // next j
             };
-            boost::asio::thread_pool pool3(processor_count);
-            // A needs filled each loop because the _gsl partial pivot decomposition modifies the matrix
-            for (int i=0; i<SIZE; i++) {
-                if (multi_thread) {
-                    boost::asio::post(pool3, [&_fillA, i, p, SIZE]{ _fillA(i, p, SIZE) ;});
+            // A is filled only when no cached factorization exists for dt[p], the factorization overwrites it
+            int nRows = options.packed_solver ? nOrbits : SIZE;
+            for (int i=0; i<nRows && fill; i++) {
+                if (multi_thread && options.packed_solver) {
+                    pool.run([&_fillB, i]{ _fillB(i) ;});
+                } else if (multi_thread) {
+                    pool.run([&_fillA, i, SIZE]{ _fillA(i, SIZE) ;});
+                } else if (options.packed_solver) {
+                    _fillB(i);
                 } else {
-                    _fillA(i, p, SIZE);
+                    _fillA(i, SIZE);
                 }  // if (multi_thread);
             }  // next i
-            pool3.join();
+            pool.wait();
 
             end = std::chrono::steady_clock::now();  // _fill_A
             milli = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
@@ -318,39 +473,162 @@ namespace gt { namespace gfunction {
 
             // ----- temporal superposition
             start = std::chrono::steady_clock::now();
-            _temporal_superposition(Tb_0,
-                                    SegRes,
-                                    H_ij,
-                                    q_r,
-                                    p,
-                                    nSources);
+            if (options.superposition_tol > 0) {
+                _aggregated_superposition(Tb_0, SegRes, q_r, p, nSources, options.superposition_tol);
+            } else if (blocked) {
+                int c = (p - nt_old) % options.superposition_block;
+                if (c == 0) {
+                    _far_superposition(Tb_far, k_far, SegRes, time, _time, Q, dt, p,
+                                       std::min(options.superposition_block, nt - p), dh_full);
+                }
+                _temporal_superposition(Tb_0, SegRes, q_r, p, nSources, k_far[c]);
+                for (int i=0; i<nSources; i++) {
+                    Tb_0[i] += Tb_far[c * nSources + i];
+                }
+            } else {
+                _temporal_superposition(Tb_0,
+                                        SegRes,
+                                        q_r,
+                                        p,
+                                        nSources);
+            }
             // fill b with -Tb
             b_[SIZE-1] = Hb_sum;
-            for (int i=0; i<Tb_0.size(); i++) {
-                b_[i] = -Tb_0[i];
+            for (int o=0; o<nOrbits; o++) {
+                b_[o] = -Tb_0[orbitRep[o]];
             }
             end = std::chrono::steady_clock::now();
             milli = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
             temporal_superposition_time += milli;
 
-            int m = SIZE;
             int n = SIZE;
             vector<double> x(b_.size());
-//            _solve_eqn(x, A, b);
-            /** was _solve_eqn **/
-
-            // ---- fill gsl matrix A and b -----
-            start = std::chrono::steady_clock::now();
-
-            end = std::chrono::steady_clock::now();
-            milli = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
-            fill_gsl_matrices_time += milli;
 
             // ----- LU decomposition -----
             start = std::chrono::steady_clock::now();
-            jcc::la::gesv(n, nrhs, A_, lda, _ipiv, b_, ldb, info);
+            if (options.iterative_solver) {
+                // the system is applied through the response factors at dt[p], A is not filled
+                int k;
+                double w0;
+                double w1;
+                jcc::interpolation::interp_weights(dt[p], time, k, w0, w1);
+                vector<double> Q_p(nSources);
+                vector<double> hQ(nSources);
+                auto _A = [&](const double *x_, double *y) {
+                    for (int j=0; j<nSources; j++) {
+                        Q_p[j] = x_[orbitOf[j]];
+                    }
+                    std::fill(hQ.begin(), hQ.end(), 0.);
+                    _interpolated_product(hQ, SegRes, k, w0, w1, Q_p.data());
+                    y[nOrbits] = 0;
+                    for (int j=0; j<nSources; j++) {
+                        y[nOrbits] += Hb[j] * Q_p[j];
+                    }
+                    for (int o=0; o<nOrbits; o++) {
+                        y[o] = hQ[orbitRep[o]] - x_[nOrbits];
+                    }
+                };
+                // the diagonal of the heat extraction rates as preconditioner, with the border of the borehole
+                // wall temperature eliminated exactly: M = [D, -1; c^T, 0]
+                vector<double> D(nOrbits, 0.);
+                vector<double> c(nOrbits, 0.);
+                for (int j=0; j<nSources; j++) {
+                    int o = orbitOf[j];
+                    double h;
+                    SegRes.get_h_value(h, orbitRep[o], j, k);
+                    D[o] += w0 * h;
+                    if (w1 != 0) {
+                        SegRes.get_h_value(h, orbitRep[o], j, k + 1);
+                        D[o] += w1 * h;
+                    }
+                    c[o] += Hb[j];
+                }  // next j
+                double cD = 0;
+                for (int o=0; o<nOrbits; o++) {
+                    cD += c[o] / D[o];
+                }
+                auto _M = [&](const double *r, double *z) {
+                    double z_T = r[nOrbits];
+                    for (int o=0; o<nOrbits; o++) {
+                        z_T -= c[o] * r[o] / D[o];
+                    }
+                    z_T /= cD;
+                    for (int o=0; o<nOrbits; o++) {
+                        z[o] = (r[o] + z_T) / D[o];
+                    }
+                    z[nOrbits] = z_T;
+                };
+                // warm-started from the previous time step
+                if (p > 0) {
+                    for (int o=0; o<nOrbits; o++) {
+                        x[o] = Q[orbitRep[o]][p-1];
+                    }
+                    x[nOrbits] = gFunction[p-1];
+                }
+                iterations += gt::solvers::gmres(_A, _M, b_, x, options.iterative_tol);
+            } else if (options.packed_solver) {
+                // B = L D L^T (Bunch-Kaufman), then B u = H_o r and B v = H_o, the borehole wall temperature being
+                // T = (sum(Hb) - H_o^T u) / (H_o^T v) by the border row and q = u + T v
+                char uplo = 'L';
+                int nB = nOrbits;
+                int nrhs_B = 2;
+                if (factorization == nullptr) {
+                    dsptrf_(&uplo, &nB, &*A_.begin(), &*_ipiv.begin(), &info);
+                    // a failed factorization is never cached
+                    _check_info(info, "dsptrf");
+                    if (factorizations.size() < size_t(options.factorization_cache)) {
+                        Factorization &LDL = factorizations[dt[p]];
+                        LDL.A = A_;
+                        LDL.ipiv = _ipiv;
+                        factorization = &LDL;
+                    }
+                }
+                for (int o=0; o<nOrbits; o++) {
+                    uv[o] = H_o[o] * b_[o];
+                    uv[nOrbits + o] = H_o[o];
+                }
+                double *LDL = factorization != nullptr ? &*factorization->A.begin() : &*A_.begin();
+                int *ipiv = factorization != nullptr ? &*factorization->ipiv.begin() : &*_ipiv.begin();
+                dsptrs_(&uplo, &nB, &nrhs_B, LDL, ipiv, &*uv.begin(), &nB, &info);
+                _check_info(info, "dsptrs");
+                double mu = 0;
+                double mv = 0;
+                for (int o=0; o<nOrbits; o++) {
+                    mu += H_o[o] * uv[o];
+                    mv += H_o[o] * uv[nOrbits + o];
+                }
+                if (mv == 0) {
+                    throw runtime_error("The border of the system of equations of the time step is singular "
+                                        "(H_o^T v = 0).");
+                }
+                double T = (b_[nOrbits] - mu) / mv;
+                for (int o=0; o<nOrbits; o++) {
+                    b_[o] = uv[o] + T * uv[nOrbits + o];
+                }
+                b_[nOrbits] = T;
+            } else if (options.factorization_cache <= 0) {
+                jcc::la::gesv(n, nrhs, A_, lda, _ipiv, b_, ldb, info);
+                _check_info(info, "dgesv");
+            } else {
+                if (factorization == nullptr) {
+                    dgetrf_(&n, &n, &*A_.begin(), &lda, &*_ipiv.begin(), &info);
+                    // a failed factorization is never cached
+                    _check_info(info, "dgetrf");
+                    if (factorizations.size() < size_t(options.factorization_cache)) {
+                        Factorization &LU = factorizations[dt[p]];
+                        LU.A = A_;
+                        LU.ipiv = _ipiv;
+                        factorization = &LU;
+                    }
+                }
+                char trans = 'N';
+                double *LU = factorization != nullptr ? &*factorization->A.begin() : &*A_.begin();
+                int *ipiv = factorization != nullptr ? &*factorization->ipiv.begin() : &*_ipiv.begin();
+                dgetrs_(&trans, &n, &nrhs, LU, &lda, ipiv, &*b_.begin(), &ldb, &info);
+                _check_info(info, "dgetrs");
+            }
 
-            for (int i=0; i<SIZE; i++) {
+            for (int i=0; i<SIZE && !options.iterative_solver; i++) {
                 x[i] = b_[i];
             } // next i
             end = std::chrono::steady_clock::now();
@@ -359,7 +637,7 @@ namespace gt { namespace gfunction {
 
             // ---- Save Q's for next p ---
             for (int j=0; j<Q.size(); j++) {
-                Q[j][p] = x[j];
+                Q[j][p] = x[orbitOf[j]];
             } // next j
             // the borehole wall temperatures are equal for all segments
             double Tb = x[x.size()-1];
@@ -372,7 +650,6 @@ namespace gt { namespace gfunction {
         fill_A_time /= 1000;
         load_history_reconstruction_time /= 1000;
         temporal_superposition_time /= 1000;
-        fill_gsl_matrices_time /= 1000;
         LU_decomposition_time /= 1000;
 
         if (display) {
@@ -381,15 +658,18 @@ namespace gt { namespace gfunction {
             cout << segment_length_time << "\t" << segment_length_time << "\t" << "segment length time" << endl;
             cout << time_vector_time << "\t" << time_vector_time << "\t" << "time vector time" << endl;
             cout << segment_h_values_time << "\t" << segment_h_values_time << "\t" << "segment h values time" << endl;
-            cout << fill_A_time << "\t" << fill_A_time / double(nt) << "\t" << "time to fill vector A" << endl;
-            cout << load_history_reconstruction_time << "\t" << load_history_reconstruction_time / double(nt)
+            cout << fill_A_time << "\t" << fill_A_time / double(nt - nt_old) << "\t" << "time to fill vector A"
+                 << endl;
+            cout << load_history_reconstruction_time << "\t" << load_history_reconstruction_time / double(nt - nt_old)
                  << "\t" << "load hist reconstruction" << endl;
-            cout << temporal_superposition_time << "\t" << temporal_superposition_time / double(nt)
+            cout << temporal_superposition_time << "\t" << temporal_superposition_time / double(nt - nt_old)
                  << "\t" << "temporal superposition time:" << endl;
-            cout << fill_gsl_matrices_time << "\t" << fill_gsl_matrices_time / double(nt)
-                 << "\t" << "gsl fill matrices time" << endl;
-            cout << LU_decomposition_time << "\t" << LU_decomposition_time/double(nt)
+            cout << LU_decomposition_time << "\t" << LU_decomposition_time/double(nt - nt_old)
                  << "\t" << "LU decomp time" << endl;
+            if (options.iterative_solver) {
+                cout << iterations << "\t" << iterations / double(nt - nt_old) << "\t" << "GMRES iterations"
+                     << endl;
+            }
         }
 
         auto end2 = std::chrono::steady_clock::now();
@@ -407,7 +687,7 @@ namespace gt { namespace gfunction {
         }
 
         return gFunction;
-    }  // uniform_borehole_wall_temperature();
+    }  // UniformBoreholeWallTemperature::extend();
 
     void _borehole_segments(std::vector<gt::boreholes::Borehole>& boreSegments,
             std::vector<gt::boreholes::Borehole>& boreholes, const int nSegments) {
@@ -495,9 +775,48 @@ namespace gt { namespace gfunction {
         }
     } // load_history_reconstruction
 
+    void _interpolated_product(vector<double> &y, gt::heat_transfer::SegmentResponse &SegRes, const int k,
+                               const double w0, const double w1, const double *x) {
+        int nSources = SegRes.nSources;
+        // h(i, j) x_j for i > j is H_j / H_i h(j, i) x_j, accumulated as h(j, i) (H_j x_j) then divided by H_i
+        vector<double> H(nSources);
+        vector<double> Hx(nSources);
+        for (int i=0; i<nSources; i++) {
+            H[i] = SegRes.boreSegments[i].H;
+            Hx[i] = H[i] * x[i];
+        }
+        vector<double> buffer(SegRes.storage_mode == 0 ? SegRes.nSum : 0);
+        vector<double> lower(nSources);
+        for (int s=0; s<2; s++) {
+            double w = s == 0 ? w0 : w1;
+            if (w == 0) {
+                continue;
+            }
+            if (SegRes.storage_mode == 2) {
+                SegRes.hMatrix->multiply(k + s, w, x, y.data());
+                continue;
+            }
+            const double *h = SegRes.time_slice(k + s, buffer.data());
+            std::fill(lower.begin(), lower.end(), 0.);
+            int index = 0;
+            for (int i=0; i<nSources; i++) {
+                double upper = h[index] * x[i];
+                index++;
+                for (int j=i+1; j<nSources; j++, index++) {
+                    upper += h[index] * x[j];
+                    lower[j] += h[index] * Hx[i];
+                }
+                y[i] += w * upper;
+            }  // next i
+            for (int j=0; j<nSources; j++) {
+                y[j] += w * lower[j] / H[j];
+            }
+        }  // next s
+    }  // _interpolated_product();
+
     void _temporal_superposition(vector<double>& Tb_0, gt::heat_transfer::SegmentResponse &SegRes,
-                                 vector<double> &h_ij, vector<double> &q_reconstructed,
-                                 const int p, int &nSources)
+                                 vector<double> &q_reconstructed,
+                                 const int p, int &nSources, const int k_end)
             {
         // This function performs equation (37) of Cimmino (2017)
         std::fill(Tb_0.begin(), Tb_0.end(), 0);
@@ -506,30 +825,56 @@ namespace gt { namespace gfunction {
 
         int gauss_sum = nSources * (nSources + 1) / 2;  // Number of positions in packed symmetric matrix
         // Storage of h_ij differences
-        std::vector<double> dh_ij(gauss_sum, 0);
-        int begin_1;  // integer declarations for where the linear algebra will begin
-        int begin_2;
+        std::vector<double> dh_ij(SegRes.dh_ij.empty() ? gauss_sum : 0, 0);
+        // Time slices built from the similarities (storage_mode = 0)
+        std::vector<double> h_k(SegRes.storage_mode == 0 ? gauss_sum : 0);
         int begin_q;  // time for q_reconstructed to begin
         int inc = 1;  // the vectors are of increment 1, they can be completely unwrapped in BLAS
 
         double alpha = 1;
         double alpha_n = -1;
 
-        for (int k = 0; k < nt; k++) {
+        if (SegRes.storage_mode == 2) {
+            // sum_k (h(k) - h(k-1)) q(t_p - t_k) = sum_k h(k) (q(t_p - t_k) - q(t_p - t_k+1)), one compressed
+            // product per time
+            std::vector<double> dq(nSources);
+            for (int k = 0; k < nt; k++) {
+                begin_q = (nt - k - 1) * nSources;
+                for (int i=0; i<nSources; i++) {
+                    dq[i] = q_reconstructed[begin_q + i] - (k < nt - 1 ? q_reconstructed[begin_q - nSources + i] : 0);
+                }
+                SegRes.hMatrix->multiply(k, alpha, dq.data(), Tb_0.data());
+            }  // next k
+            return;
+        }
+        int nk = k_end >= 0 ? std::min(nt, k_end) : nt;  // the times superposed
+        for (int k = 0; k < nk; k++) {
+            // q_reconstructed(t_k - t_k')
+            begin_q = (nt - k - 1) * nSources;
+            if (_sparse_slice(SegRes, k)) {
+                // dh_ij is only taken where the response factors are not 0
+                _sparse_symmetric_product(SegRes, k, true, &q_reconstructed.at(begin_q), 1, &*Tb_0.begin());
+                continue;
+            }
+            if (!SegRes.dh_ij.empty()) {
+                // the stored difference, Tb_0 = 1 * dh(k) * q(t_k-t_k') + 1 * Tb_0
+                char uplo = 'l';
+                dspmv_(&uplo, &nSources, &alpha, const_cast<double *>(SegRes.dh_slice(k)),
+                       &q_reconstructed.at(begin_q), &inc, &alpha, &*Tb_0.begin(), &inc);
+                continue;
+            }
             if (k==0){
                 // dh_ij = h(k)
-                begin_1 = k * gauss_sum;
-                dcopy_(&gauss_sum, &h_ij.at(begin_1), &inc, &*dh_ij.begin(), &inc);
+                dcopy_(&gauss_sum, const_cast<double *>(SegRes.time_slice(k, h_k.data())), &inc, &*dh_ij.begin(),
+                       &inc);
             } else {
-                begin_1 = k * gauss_sum;
-                begin_2 = (k-1) * gauss_sum;
                 // h_1 -> dh_ij
-                dcopy_(&gauss_sum, &h_ij.at(begin_1), &inc, &*dh_ij.begin(), &inc);
+                dcopy_(&gauss_sum, const_cast<double *>(SegRes.time_slice(k, h_k.data())), &inc, &*dh_ij.begin(),
+                       &inc);
                 // dh_ij = -1 * h(k) + h(k-1)
-                daxpy_(&gauss_sum, &alpha_n, &h_ij.at(begin_2), &inc, &*dh_ij.begin(), &inc);
+                daxpy_(&gauss_sum, &alpha_n, const_cast<double *>(SegRes.time_slice(k-1, h_k.data())), &inc,
+                       &*dh_ij.begin(), &inc);
             }
-            // q_reconstructed(t_k - t_k')
-            begin_q = (nt - k - 1) * nSources;
             // dh_ij is a lower triangular packed matrix
             char uplo = 'l';
             // Tb_0 = 1 * dh_ij * q(t_k-t_k') + 1 * Tb_0
@@ -537,4 +882,180 @@ namespace gt { namespace gfunction {
                    &alpha, &*Tb_0.begin(), &inc);
         }  // next k
     }  // _temporal_superposition();
+
+    void _aggregated_superposition(vector<double>& Tb_0, gt::heat_transfer::SegmentResponse &SegRes,
+                                   vector<double> &q_reconstructed, const int p, const int nSources,
+                                   const double tol) {
+        std::fill(Tb_0.begin(), Tb_0.end(), 0);
+        int nt = p + 1;
+        int gauss_sum = nSources * (nSources + 1) / 2;
+        std::vector<double> h_k(SegRes.storage_mode == 0 ? gauss_sum : 0);
+        int inc = 1;
+        double alpha = 1;
+
+        // the increment of the response factors of each time, measured on the diagonal
+        std::vector<double> w(nt);
+        double h_1 = 0;
+        for (int k=0; k<nt; k++) {
+            double h = 0;
+            for (int i=0; i<nSources; i++) {
+                double h_ii;
+                SegRes.get_h_value(h_ii, i, i, k);
+                h += h_ii;
+            }
+            w[k] = std::abs(h - h_1);
+            h_1 = h;
+        }  // next k
+        double q_max = 0;
+        for (int n=0; n<nt*nSources; n++) {
+            q_max = std::max(q_max, std::abs(q_reconstructed[n]));
+        }
+
+        // the blocks of times [a, e], q(k) = q_reconstructed(nt - k - 1)
+        auto _q = [&q_reconstructed, nt, nSources](int k) { return &q_reconstructed[(nt - k - 1) * nSources]; };
+        std::vector<int> ends;
+        std::vector<std::vector<double>> q_mean;
+        std::vector<double> q_lo(nSources);
+        std::vector<double> q_hi(nSources);
+        int a = 0;
+        while (a < nt) {
+            const double *q = _q(a);
+            for (int i=0; i<nSources; i++) {
+                q_lo[i] = q_hi[i] = q[i];
+            }
+            int e = a;
+            while (e + 1 < nt) {
+                q = _q(e + 1);
+                bool within = true;
+                for (int i=0; i<nSources && within; i++) {
+                    within = std::max(q_hi[i], q[i]) - std::min(q_lo[i], q[i]) <= tol * q_max;
+                }
+                if (!within) {
+                    break;
+                }
+                for (int i=0; i<nSources; i++) {
+                    q_lo[i] = std::min(q_lo[i], q[i]);
+                    q_hi[i] = std::max(q_hi[i], q[i]);
+                }
+                e++;
+            }  // while (e + 1 < nt);
+            double w_sum = 0;
+            for (int k=a; k<=e; k++) {
+                w_sum += w[k];
+            }
+            std::vector<double> mean(nSources, 0.);
+            for (int k=a; k<=e; k++) {
+                double w_k = w_sum > 0 ? w[k] / w_sum : 1. / (e - a + 1);
+                q = _q(k);
+                for (int i=0; i<nSources; i++) {
+                    mean[i] += w_k * q[i];
+                }
+            }  // next k
+            ends.push_back(e);
+            q_mean.push_back(mean);
+            a = e + 1;
+        }  // while (a < nt);
+
+        // sum_B (h(e_B) - h(a_B - 1)) q_B = sum_B h(e_B) (q_B - q_B+1), one product per block
+        std::vector<double> dq(nSources);
+        for (int b=0; b<ends.size(); b++) {
+            int k = ends[b];
+            for (int i=0; i<nSources; i++) {
+                dq[i] = q_mean[b][i] - (b + 1 < ends.size() ? q_mean[b + 1][i] : 0);
+            }
+            if (SegRes.storage_mode == 2) {
+                SegRes.hMatrix->multiply(k, alpha, dq.data(), Tb_0.data());
+            } else if (_sparse_slice(SegRes, k)) {
+                _sparse_symmetric_product(SegRes, k, false, &*dq.begin(), 1, &*Tb_0.begin());
+            } else {
+                char uplo = 'l';
+                int n = nSources;
+                dspmv_(&uplo, &n, &alpha, const_cast<double *>(SegRes.time_slice(k, h_k.data())), &*dq.begin(),
+                       &inc, &alpha, &*Tb_0.begin(), &inc);
+            }
+        }  // next b
+    }  // _aggregated_superposition();
+
+    void _far_superposition(vector<double> &Tb_far, vector<int> &k_far, gt::heat_transfer::SegmentResponse &SegRes,
+                            vector<double> &time, vector<double> &_time, vector<vector<double> > &Q,
+                            vector<double> &dt, const int p0, const int nBlock, vector<double> &dh) {
+        int nSources = SegRes.nSources;
+        int gauss_sum = SegRes.nSum;
+        // the loads of each step of the block reconstructed with the heat extraction rates known at p0, those of the
+        // intervals that end by _time[p0] are the loads the step will reconstruct
+        vector<vector<double>> q_block(nBlock);
+        k_far.assign(nBlock, 0);
+        for (int c=0; c<nBlock; c++) {
+            int p = p0 + c;
+            q_block[c].assign(size_t(nSources) * (p + 1), 0.);
+            load_history_reconstruction(q_block[c], time, _time, Q, dt, p);
+            // the end of the interval of q_reconstructed(j), summed as load_history_reconstruction sums it
+            double t_end = 0;
+            int j = 0;
+            for (; j<p; j++) {
+                t_end += dt[p - j];
+                if (t_end > _time[p0]) {
+                    break;
+                }
+            }  // next j
+            // q_reconstructed(j) is superposed with the response factors of time p - j
+            k_far[c] = p - j + 1;
+        }  // next c
+
+        Tb_far.assign(size_t(nSources) * nBlock, 0.);
+        vector<int> columns;
+        vector<double> X;
+        vector<double> Y;
+        vector<double> h_k(SegRes.storage_mode == 0 ? gauss_sum : 0);
+        vector<double> h_1(SegRes.storage_mode == 0 ? gauss_sum : 0);
+        char side = 'l';
+        char uplo = 'l';
+        double alpha = 1;
+        int k_begin = *std::min_element(k_far.begin(), k_far.end());
+        for (int k=k_begin; k<p0+nBlock; k++) {
+            // the steps of the block whose load superposed with time k is known
+            columns.clear();
+            for (int c=0; c<nBlock; c++) {
+                if (k_far[c] <= k && k <= p0 + c) {
+                    columns.push_back(c);
+                }
+            }  // next c
+            int m = columns.size();
+            if (m == 0) {
+                continue;
+            }
+            // the loads and the superposition of the steps, column-major (nSources x m)
+            X.resize(size_t(nSources) * m);
+            Y.assign(size_t(nSources) * m, 0.);
+            for (int n=0; n<m; n++) {
+                int c = columns[n];
+                std::copy(&q_block[c][size_t(p0 + c - k) * nSources],
+                          &q_block[c][size_t(p0 + c - k + 1) * nSources], &X[size_t(n) * nSources]);
+            }  // next n
+            if (_sparse_slice(SegRes, k)) {
+                _sparse_symmetric_product(SegRes, k, true, &*X.begin(), m, &*Y.begin());
+            } else {
+                // column i of the packed lower matrix is the rows i, ..., nSources - 1 of column i
+                const double *h = SegRes.dh_ij.empty() ? SegRes.time_slice(k, h_k.data()) : SegRes.dh_slice(k);
+                const double *h_prev = SegRes.dh_ij.empty() && k > 0 ? SegRes.time_slice(k-1, h_1.data()) : nullptr;
+                int index = 0;
+                for (int i=0; i<nSources; i++) {
+                    double *column = &dh[size_t(i) * nSources];
+                    for (int j=i; j<nSources; j++, index++) {
+                        column[j] = h_prev != nullptr ? h[index] - h_prev[index] : h[index];
+                    }
+                }  // next i
+                // Y = dh X, every entry of dh read once for the m steps
+                dsymm_(&side, &uplo, const_cast<int *>(&nSources), &m, &alpha, &*dh.begin(),
+                       const_cast<int *>(&nSources), &*X.begin(), const_cast<int *>(&nSources), &alpha, &*Y.begin(),
+                       const_cast<int *>(&nSources));
+            }
+            for (int n=0; n<m; n++) {
+                int c = columns[n];
+                for (int i=0; i<nSources; i++) {
+                    Tb_far[size_t(c) * nSources + i] += Y[size_t(n) * nSources + i];
+                }
+            }  // next n
+        }  // next k
+    }  // _far_superposition();
 } } // namespace gt::gfunction
@@ -3,70 +3,214 @@
 //
 
 #include <cpgfunction/heat_transfer.h>
+#include <algorithm>
+#include <cstring>
+#include <memory>
 #include <stdexcept>
 #include <thread>
-#include <boost/asio.hpp>
+#include <boost/align/aligned_alloc.hpp>
+#include <boost/math/special_functions/expint.hpp>
 #include <cpgfunction/boreholes.h>
+#include <cpgfunction/executor.h>
+#include <cpgfunction/fls_integrand.h>
+#include <cpgfunction/hmatrix.h>
+#include <cpgfunction/kernel_cache.h>
 
 using namespace boost::math::quadrature;
 
 namespace gt { namespace heat_transfer {
-    double finite_line_source(const double time_, const double alpha, gt::boreholes::Borehole &b1,
-                              gt::boreholes::Borehole &b2, bool reaSource, bool imgSource) {
+    // Adaptive 15 point Gauss-Kronrod quadrature of an integrand evaluated at all of the nodes of an interval at
+    // once, f(s, fs, n). The interval is refined while the error is larger than rel_tol times the estimate and
+    // larger than abs_tol; when abs_tol is 0 it is set from the first estimate (as in
+    // boost::math::quadrature::gauss_kronrod). The segments integrated by the time vector version of the FLS
+    // solution are as small as the gaps between consecutive lower bounds, so that version sets an absolute tolerance
+    // instead, a relative tolerance would refine the negligible short time segments.
+    template <class F>
+    static double _gauss_kronrod_15(F &f, const double a, const double b, const double rel_tol, double abs_tol,
+                                    const unsigned max_depth, double *L1) {
+        const auto &x = gauss_kronrod<double, 15>::abscissa();
+        const auto &w = gauss_kronrod<double, 15>::weights();
+        const auto &wg = gauss<double, 7>::weights();
+        double mean = (b + a) / 2;
+        double scale = (b - a) / 2;
 
-        auto _Ils = [&b1, &b2, reaSource, imgSource](const double s) {
-            auto _erfint = [](const double x) {
-                return x * std::erf(x) - (1 / sqrt(M_PI)) * (1 - exp(-pow(x, 2)));
-            };
-            double r = b1.distance(b2);
-            double func = 0.;
-            // function to integrate
-            if (reaSource) {
-                // Real part of the FLS solution
-                func += _erfint(double(b2.D - b1.D + b2.H) * s);
-                func += -_erfint(double(b2.D - b1.D) * s);
-                func += _erfint(double(b2.D - b1.D - b1.H) * s);
-                func += -_erfint(double(b2.D - b1.D + b2.H - b1.H) * s);
-            } // fi reaSource
-            if (imgSource) {
-                // Image part of the FLS solution
-                func += _erfint(double(b2.D + b1.D + b2.H) * s);
-                func += -_erfint(double(b2.D + b1.D) * s);
-                func += _erfint(double(b2.D + b1.D + b1.H) * s);
-                func += -_erfint(double(b2.D + b1.D + b2.H + b1.H) * s);
-            } // fi imgSource
-            double a = 0.5 / (b2.H * pow(s, 2)) * func * exp(-pow(r, 2) * pow(s, 2));
-            return a;
-        }; // auto _Ils
+        double s[15];
+        double fs[15];
+        s[0] = mean;
+        for (int i=1; i<8; i++) {
+            s[2*i-1] = mean + scale * x[i];
+            s[2*i] = mean - scale * x[i];
+        } // next i
+        f(s, fs, 15);
+
+        double kronrod = fs[0] * w[0];
+        double gauss_ = fs[0] * wg[0];
+        double l1 = abs(fs[0]) * w[0];
+        double fp;
+        double fm;
+        for (int i=1; i<8; i++) {
+            fp = fs[2*i-1];
+            fm = fs[2*i];
+            kronrod += (fp + fm) * w[i];
+            l1 += (abs(fp) + abs(fm)) * w[i];
+            if (i % 2 == 0) {
+                gauss_ += (fp + fm) * wg[i / 2];
+            }
+        } // next i
+        double error = abs(kronrod - gauss_) * abs(scale);
+        double estimate = kronrod * scale;
+
+        double abs_tol1 = abs(estimate * rel_tol);
+        if (abs_tol == 0) {
+            abs_tol = abs_tol1;
+        }
+        if (max_depth > 0 && abs_tol1 < error && abs_tol < error) {
+            double mid = (a + b) / 2;
+            double L1_1;
+            double L1_2;
+            double Q = _gauss_kronrod_15(f, a, mid, rel_tol, abs_tol / 2, max_depth - 1, &L1_1);
+            Q += _gauss_kronrod_15(f, mid, b, rel_tol, abs_tol / 2, max_depth - 1, &L1_2);
+            *L1 = L1_1 + L1_2;
+            return Q;
+        }
+        *L1 = l1 * abs(scale);
+        return estimate;
+    } // _gauss_kronrod_15()
+
+    // Integral from a to infinity with the same transformation as boost, s = 2 / (t + 1) + a - 1 for t in (-1, 1]
+    template <class F>
+    static double _gauss_kronrod_15_tail(F &f, const double a, const double rel_tol, const double abs_tol,
+                                         const unsigned max_depth, double *L1) {
+        auto _f_t = [&f, a](const double *t, double *ft, const int n) {
+            double s[15];
+            double z[15];
+            for (int i=0; i<n; i++) {
+                z[i] = 1 / (t[i] + 1);
+                s[i] = 2 * z[i] + a - 1;
+            }
+            f(s, ft, n);
+            for (int i=0; i<n; i++) {
+                ft[i] *= z[i] * z[i];
+            }
+        };
+        double Q = 2 * _gauss_kronrod_15(_f_t, -1, 1, rel_tol, abs_tol / 2, max_depth, L1);
+        *L1 *= 2;
+        return Q;
+    } // _gauss_kronrod_15_tail()
+
+    double finite_line_source(const double time_, const double alpha, gt::boreholes::Borehole &b1,
+                              gt::boreholes::Borehole &b2, bool reaSource, bool imgSource, bool vectorize) {
+        FLSIntegrand integrand(b1, b2, reaSource, imgSource);
 
         // lower bound of integration
         double a = double(1.) / sqrt(double(4.) * alpha * time_);
-        // Evaluate the integral using Gauss-Kronrod
-        double error;
-        double Q = gauss_kronrod<double, 15>::integrate(_Ils, a, std::numeric_limits<double>::infinity(),
-                                                        5, 1e-9, &error);
+        double Q;
+        if (vectorize) {
+            auto _Ils = [&integrand](const double *s, double *f, const int n) {
+                integrand.evaluate(s, f, n);
+            }; // auto _Ils
+            double L1;
+            Q = _gauss_kronrod_15_tail(_Ils, a, 1e-9, 0, 5, &L1);
+        } else {
+            auto _Ils = [&integrand](const double s) {
+                double f;
+                integrand.evaluate_scalar(&s, &f, 1);
+                return f;
+            }; // auto _Ils
+            // Evaluate the integral using Gauss-Kronrod
+            double error;
+            Q = gauss_kronrod<double, 15>::integrate(_Ils, a, std::numeric_limits<double>::infinity(),
+                                                     5, 1e-9, &error);
+        }
         return Q;
 
     } // void finite_line_source
 
+    void finite_line_source(vector<double> &h, vector<double> &time, const double alpha,
+                            gt::boreholes::Borehole &b1, gt::boreholes::Borehole &b2, bool reaSource,
+                            bool imgSource, bool vectorize) {
+        FLSIntegrand integrand(b1, b2, reaSource, imgSource);
+        auto _Ils = [&integrand, vectorize](const double *s, double *f, const int n) {
+            if (vectorize) {
+                integrand.evaluate(s, f, n);
+            } else {
+                integrand.evaluate_scalar(s, f, n);
+            }
+        }; // auto _Ils
+
+        int nt = time.size();
+        h.resize(nt);
+        if (nt == 0) {
+            return;
+        }
+        // the time vector is expected to be increasing, but the order of integration is sorted to be safe
+        vector<int> order(nt);
+        for (int k=0; k<nt; k++) {
+            order[k] = k;
+        }
+        if (!is_sorted(time.begin(), time.end())) {
+            stable_sort(order.begin(), order.end(), [&time](const int k1, const int k2) {
+                return time[k1] < time[k2];
+            });
+        }
+        // lower bounds of integration, decreasing with time
+        vector<double> a(nt);
+        for (int k=0; k<nt; k++) {
+            a[k] = double(1.) / sqrt(double(4.) * alpha * time[order[k]]);
+        }
+
+        // The L1 norm of the integrand over the entire domain (longest time) scales the absolute tolerance
+        double L1;
+        _gauss_kronrod_15_tail(_Ils, a[nt-1], 1e-9, 0, 5, &L1);
+        double abs_tol = 1e-9 * L1;
+
+        // Integral from the lower bound of the shortest time to infinity
+        double Q = _gauss_kronrod_15_tail(_Ils, a[0], 0, abs_tol, 5, &L1);
+        h[order[0]] = Q;
+        // Accumulate the integrals between consecutive lower bounds
+        for (int k=1; k<nt; k++) {
+            if (a[k] < a[k-1]) {
+                Q += _gauss_kronrod_15(_Ils, a[k], a[k-1], 0, abs_tol, 5, &L1);
+            }
+            h[order[k]] = Q;
+        } // next k
+    } // void finite_line_source
+
+    double prune_distance(const double time_, const double alpha, const double tol) {
+        // 0.5 * E1(x) = tol is solved for x = r^2 / (4 alpha t) by bisection, E1 is decreasing
+        double x_lo = 0;
+        double x_hi = 1;
+        while (0.5 * boost::math::expint(1, x_hi) > tol) {
+            x_lo = x_hi;
+            x_hi *= 2;
+        }
+        for (int it=0; it<60; it++) {
+            double x = (x_lo + x_hi) / 2;
+            if (0.5 * boost::math::expint(1, x) > tol) {
+                x_lo = x;
+            } else {
+                x_hi = x;
+            }
+        }  // next it
+        return sqrt(4 * alpha * time_ * x_hi);
+    }  // prune_distance();
+
     void
-    thermal_response_factors(SegmentResponse &SegRes, std::vector< std::vector< std::vector<double> > >& h_ij,
-                             std::vector<gt::boreholes::Borehole> &boreSegments,
+    thermal_response_factors(SegmentResponse &SegRes, std::vector<gt::boreholes::Borehole> &boreSegments,
                              std::vector<double> &time,
-                             const double alpha, bool use_similaries, bool disp) {
+                             const double alpha, bool use_similaries, bool disp,
+                             const gt::options::Options &options, const int n_Threads) {
         // total number of line sources
         int nSources = boreSegments.size();
         // number of time values
         int nt = time.size();
 
-        // Open up processes here
-        // Create a vector of threads
-        //may return 0 when not able to detect
-        const auto processor_count = thread::hardware_concurrency();
-        // Launch the pool with n threads.
-        boost::asio::thread_pool pool(processor_count);
+        // The tasks of every phase are run on the shared executor, at most n_Threads at a time
+        gt::parallel::Executor &executor = options.executor != nullptr ? *options.executor
+                : gt::parallel::Executor::instance();
+        gt::parallel::TaskGroup pool(executor, n_Threads);
         if (disp) {
-            cout << "\tDetected " << processor_count << " as the number of available threads" << endl;
+            cout << "\tUsing " << pool.concurrency() << " threads" << endl;
         }
 
         gt:boreholes::SimilaritiesType SimReal; // positive
@@ -84,6 +228,22 @@ namespace gt { namespace heat_transfer {
             return n * (n + 1) / 2;
         };
 
+        // the distance beyond which the response factors are pruned at each time value, none when fls_prune_tol is 0
+        vector<double> rPrune(nt, std::numeric_limits<double>::infinity());
+        if (options.fls_prune_tol > 0) {
+            for (int k=0; k<nt; k++) {
+                rPrune[k] = prune_distance(time[k], alpha, options.fls_prune_tol);
+            }
+        }
+        // the number of leading time values at which the response of a pair at distance r is pruned
+        auto _n_pruned = [&rPrune, &nt](const double r) {
+            int k = 0;
+            while (k < nt && r > rPrune[k]) {
+                k++;
+            }
+            return k;
+        };
+
         if (use_similaries) {
             auto start = std::chrono::steady_clock::now();
             // Calculations with similarities
@@ -93,16 +253,38 @@ namespace gt { namespace heat_transfer {
             bool splitRealAndImage = true;
             double disTol = 0.1;
             double tol = 1.0e-6;
-            gt::boreholes::Similarity sim;
-            sim.similarities(SimReal, SimImage, boreSegments, splitRealAndImage, disTol, tol);
+            // the streamed similarities do not list the pairs of each similarity, each pair is classified again
+            // when the response factors are stored
+            std::unique_ptr<gt::boreholes::SimilarityStream> stream;
+            if (options.similarity_stream) {
+                stream.reset(new gt::boreholes::SimilarityStream(boreSegments, disTol, tol, &pool));
+                std::swap(SimReal, stream->SimReal);
+                std::swap(SimImage, stream->SimImage);
+            } else {
+                gt::boreholes::Similarity sim;
+                sim.similarities(SimReal, SimImage, boreSegments, splitRealAndImage, disTol, tol, &pool);
+            }
 
             //---
             // Adaptive hashing scheme if statement
             // Determine the Segment Response storing mode here
             int Ntot = sum_to_n(nSources);
 
+            // Every ordered pair (i, j) is in exactly one real and one image similarity. The response of each
+            // similarity is kept (hReal, hImage) and each index records the similarity of its upper (i <= j) and
+            // lower (i > j) pair, so that no two tasks write to the same place. The response factors are then
+            // summed in a fixed order that does not depend on the number of threads.
+            vector<vector<double>> hReal(SimReal.nSim);
+            vector<vector<double>> hImage(SimImage.nSim);
+            vector<double> ratioReal(SimReal.nSim);
+            vector<double> ratioImage(SimImage.nSim);
+            vector<int> simReal(stream ? 0 : 2 * Ntot, -1);
+            vector<int> simImage(stream ? 0 : 2 * Ntot, -1);
+
             // lambda function for calculating h at each time step
-            auto _calculate_h = [&boreSegments, &splitRealAndImage, &time, &alpha, &nt, &h_ij, &SegRes, &Ntot](boreholes::SimilaritiesType &SimReal,
+            auto _calculate_h = [&boreSegments, &splitRealAndImage, &time, &alpha, &nt, &SegRes, &options, &hReal,
+                                 &hImage, &ratioReal, &ratioImage, &simReal, &simImage,
+                                 &_n_pruned](boreholes::SimilaritiesType &SimReal,
                     int s, bool reaSource, bool imgSource) {
                 // begin function
                 int n1;
@@ -110,40 +292,77 @@ namespace gt { namespace heat_transfer {
                 gt::boreholes::Borehole b1;
                 gt::boreholes::Borehole b2;
                 // begin thread
-                n1 = get<0>(SimReal.Sim[s][0]);
-                n2 = get<1>(SimReal.Sim[s][0]);
+                n1 = SimReal.iSim[SimReal.offset[s]];
+                n2 = SimReal.jSim[SimReal.offset[s]];
                 b1 = boreSegments[n1];
                 b2 = boreSegments[n2];
                 vector<double> hPos(nt);
                 if (splitRealAndImage) {
-                    for (int k=0; k<nt; k++) {
-                        hPos[k] = finite_line_source(time[k], alpha, b1, b2, reaSource, imgSource);
-                    }  // next k
+                    auto _fls = [&](vector<double> &h, vector<double> &_time) {
+                        if (options.fls_time_batch) {
+                            finite_line_source(h, _time, alpha, b1, b2, reaSource, imgSource,
+                                               options.fls_vectorize);
+                        } else {
+                            h.resize(_time.size());
+                            for (int k=0; k<_time.size(); k++) {
+                                h[k] = finite_line_source(_time[k], alpha, b1, b2, reaSource, imgSource,
+                                                          options.fls_vectorize);
+                            }  // next k
+                        }
+                    };
+                    // the response is left 0 at the leading time values at which the pair is pruned
+                    int k0 = _n_pruned(b1.distance(b2));
+                    int ntKept = nt - k0;
+                    vector<double> timeKept(time.begin() + k0, time.end());
+                    vector<double> hKept(ntKept);
+                    if (ntKept == 0) {
+                        // every value is pruned
+                    } else if (options.fls_cache != nullptr) {
+                        // only integrate the values that are not found in the cache
+                        vector<bool> found;
+                        int nFound = options.fls_cache->find(hKept, found, timeKept, alpha, b1, b2, reaSource,
+                                                             imgSource);
+                        if (nFound < ntKept) {
+                            vector<double> timeMissing;
+                            vector<double> hMissing;
+                            for (int k=0; k<ntKept; k++) {
+                                if (!found[k]) {
+                                    timeMissing.push_back(timeKept[k]);
+                                }
+                            }  // next k
+                            _fls(hMissing, timeMissing);
+                            int m = 0;
+                            for (int k=0; k<ntKept; k++) {
+                                if (!found[k]) {
+                                    hKept[k] = hMissing[m++];
+                                }
+                            }  // next k
+                            options.fls_cache->insert(hKept, found, timeKept, alpha, b1, b2, reaSource, imgSource);
+                        }
+                    } else {
+                        _fls(hKept, timeKept);
+                    }
+                    std::copy(hKept.begin(), hKept.end(), hPos.begin() + k0);
                     int i;
                     int j;
-                    if (SegRes.storage_mode==0) {
-                        // not looping through every (i, j), real and image stored separately
-                        // TODO: make the option to store entire matrix
-                        throw std::invalid_argument("This storage mode does not currently exist.");
-                    } else if (SegRes.storage_mode==1) {
-                        // will loop through every (i, j), will combine real+image
-                        int index;
-                        for (int k=0; k<SimReal.Sim[s].size(); k++) {
-                            i = get<0>(SimReal.Sim[s][k]);
-                            j = get<1>(SimReal.Sim[s][k]);
-                            for (int t=0; t<time.size(); t++){
-                                // must consider real and image source separate when combining
-                                if (i <= j) {
-                                    // we want to store n2, n1
-                                    SegRes.get_index_value(index, i, j);
-                                    SegRes.h_ij[index][t] += b2.H / b1.H * hPos[t]; // non-critical race condition
-                                } else {
-                                    SegRes.get_index_value(index, j, i);
-                                    SegRes.h_ij[index][t] += hPos[t]; // non-critical race condition
-                                }  // else ()
-                            }  // next t
-                        }  // next k
-                    }  // else if(SegRes.storage_mode==1)
+                    // will loop through every (i, j), real+image are combined by _sum_h (storage_mode = 1) or
+                    // kept apart by _index_similarities (storage_mode = 0)
+                    vector<int> &simOf = reaSource ? simReal : simImage;
+                    int index;
+                    for (int64_t k=SimReal.offset[s]; k<SimReal.offset[s + 1] && !simOf.empty(); k++) {
+                        i = SimReal.iSim[k];
+                        j = SimReal.jSim[k];
+                        if (i <= j) {
+                            // we want to store n2, n1
+                            SegRes.get_index_value(index, i, j);
+                            simOf[2 * index] = s;
+                        } else {
+                            SegRes.get_index_value(index, j, i);
+                            simOf[2 * index + 1] = s;
+                        }  // else ()
+                    }  // next k
+                    (reaSource ? ratioReal : ratioImage)[s] = b2.H / b1.H;
+                    (reaSource ? hReal : hImage)[s] = std::move(hPos);
                 } else {
                     throw std::invalid_argument( "Not yet written yet.");
                 }
@@ -164,7 +383,7 @@ namespace gt { namespace heat_transfer {
             for (int s=0; s<SimReal.nSim; s++) {
                 reaSource = true;
                 imgSource = false;
-                boost::asio::post(pool, [&_calculate_h, &SimReal, s, reaSource, imgSource]
+                pool.run([&_calculate_h, &SimReal, s, reaSource, imgSource]
                 { _calculate_h(SimReal, s, reaSource, imgSource); });
 //                _calculate_h(SimReal, s, reaSource, imgSource, hash_mode);
             } // next s
@@ -172,12 +391,179 @@ namespace gt { namespace heat_transfer {
                 reaSource = false;
                 imgSource = true;
                 for (int s=0; s<SimImage.nSim; s++) {
-                    boost::asio::post(pool, [&_calculate_h, &SimImage, s, reaSource, imgSource]
+                    pool.run([&_calculate_h, &SimImage, s, reaSource, imgSource]
                     { _calculate_h(SimImage, s, reaSource, imgSource); });
 //                    _calculate_h(SimImage, s, reaSource, imgSource, hash_mode);
                 }
             }
-            pool.join();
+            pool.wait();
+
+            // sum the real and image responses of the upper and lower pair of each index, one time slice at a time
+            // (simR and simI hold the slots of the indices begin, ..., end - 1)
+            auto _sum_h = [&SegRes, &nt, &hReal, &hImage, &ratioReal, &ratioImage](const int begin, const int end,
+                    const int *simR, const int *simI) {
+                for (int t=0; t<nt; t++) {
+                    double *h = SegRes.slice(t);
+                    for (int index=begin; index<end; index++) {
+                        int k = index - begin;
+                        int s;
+                        s = simR[2 * k];
+                        if (s >= 0) {
+                            h[index] += ratioReal[s] * hReal[s][t];
+                        }
+                        s = simR[2 * k + 1];
+                        if (s >= 0) {
+                            h[index] += hReal[s][t];
+                        }
+                        s = simI[2 * k];
+                        if (s >= 0) {
+                            h[index] += ratioImage[s] * hImage[s][t];
+                        }
+                        s = simI[2 * k + 1];
+                        if (s >= 0) {
+                            h[index] += hImage[s][t];
+                        }
+                    }  // next index
+                }  // next t
+            };
+            // keep the curve of each similarity, and reduce the four slots of each index to the real and image
+            // similarity it belongs to, written to out (which may be simR: simReal becomes SegRes.simOf)
+            int nReal = SimReal.nSim;
+            auto _index_similarities = [&nReal](const int begin, const int end, const int *simR, const int *simI,
+                                                int *out) {
+                auto _ref = [](const int upper, const int lower, const int offset) {
+                    if (upper >= 0 && lower >= 0) {
+                        throw std::invalid_argument("A pair of segments is in more than one similarity.");
+                    }
+                    return upper >= 0 ? 2 * (upper + offset) : (lower >= 0 ? 2 * (lower + offset) + 1 : -1);
+                };
+                for (int k=0; k<end-begin; k++) {
+                    int real = _ref(simR[2 * k], simR[2 * k + 1], 0);
+                    int image = _ref(simI[2 * k], simI[2 * k + 1], nReal);
+                    out[2 * k] = real;
+                    out[2 * k + 1] = image;
+                }  // next k
+            };
+            if (SegRes.storage_mode == 2) {
+                // the response factors are compressed from the similarities of the upper and lower pair of each
+                // index, listed or classified again when streamed, summed as _sum_h does
+                auto _entry = [&SegRes, &stream, &simReal, &simImage, &hReal, &hImage, &ratioReal,
+                               &ratioImage](const int i, const int j, const int t) {
+                    int simR[2] = {-1, -1};
+                    int simI[2] = {-1, -1};
+                    if (stream) {
+                        int real;
+                        int image;
+                        stream->classify(i, j, real, image);
+                        simR[real >= 0 ? 0 : 1] = real >= 0 ? real : -1 - real;
+                        simI[image >= 0 ? 0 : 1] = image >= 0 ? image : -1 - image;
+                    } else {
+                        int index;
+                        SegRes.get_index_value(index, i, j);
+                        std::copy(simReal.begin() + 2 * int64_t(index), simReal.begin() + 2 * int64_t(index) + 2,
+                                  simR);
+                        std::copy(simImage.begin() + 2 * int64_t(index), simImage.begin() + 2 * int64_t(index) + 2,
+                                  simI);
+                    }
+                    double h = 0;
+                    if (simR[0] >= 0) {
+                        h += ratioReal[simR[0]] * hReal[simR[0]][t];
+                    }
+                    if (simR[1] >= 0) {
+                        h += hReal[simR[1]][t];
+                    }
+                    if (simI[0] >= 0) {
+                        h += ratioImage[simI[0]] * hImage[simI[0]][t];
+                    }
+                    if (simI[1] >= 0) {
+                        h += hImage[simI[1]][t];
+                    }
+                    return h;
+                };
+                SegRes.hMatrix = std::make_shared<HMatrix>(boreSegments, nt, _entry, options.hmatrix_tol, 2.0, 16,
+                                                           &pool);
+                if (disp) {
+                    std::cout << "H-matrix of " << SegRes.hMatrix->nBlocks() << " blocks ("
+                              << SegRes.hMatrix->nLowRank() << " low rank, mean rank "
+                              << SegRes.hMatrix->meanRank() << "): " << SegRes.hMatrix->bytes() / 1.0e6 << " MB"
+                              << std::endl;
+                }
+            } else if (!stream) {
+                int nChunks = 4 * pool.concurrency();
+                for (int c=0; c<nChunks; c++) {
+                    int begin = int(int64_t(Ntot) * c / nChunks);
+                    int end = int(int64_t(Ntot) * (c + 1) / nChunks);
+                    int *simR = simReal.data() + 2 * int64_t(begin);
+                    int *simI = simImage.data() + 2 * int64_t(begin);
+                    if (SegRes.storage_mode == 0) {
+                        pool.run([&_index_similarities, begin, end, simR, simI] {
+                            _index_similarities(begin, end, simR, simI, simR);
+                        });
+                    } else {
+                        pool.run([&_sum_h, begin, end, simR, simI] { _sum_h(begin, end, simR, simI); });
+                    }
+                }  // next c
+            } else {
+                // the slots of a chunk of rows are found by classifying its pairs again, then dropped
+                if (SegRes.storage_mode == 0) {
+                    SegRes.simOf.resize(2 * int64_t(Ntot));
+                }
+                auto _stream_rows = [&SegRes, &stream, &nSources, &Ntot, &_sum_h,
+                                     &_index_similarities](const int r_begin, const int r_end) {
+                    int begin;
+                    int end = Ntot;
+                    SegRes.get_index_value(begin, r_begin, r_begin);
+                    if (r_end < nSources) {
+                        SegRes.get_index_value(end, r_end, r_end);
+                    }
+                    vector<int> simR(2 * (end - begin), -1);
+                    vector<int> simI(2 * (end - begin), -1);
+                    int k = 0;
+                    for (int i=r_begin; i<r_end; i++) {
+                        for (int j=i; j<nSources; j++) {
+                            int real;
+                            int image;
+                            stream->classify(i, j, real, image);
+                            simR[real >= 0 ? 2 * k : 2 * k + 1] = real >= 0 ? real : -1 - real;
+                            simI[image >= 0 ? 2 * k : 2 * k + 1] = image >= 0 ? image : -1 - image;
+                            k++;
+                        }  // next j
+                    }  // next i
+                    if (SegRes.storage_mode == 0) {
+                        _index_similarities(begin, end, simR.data(), simI.data(),
+                                            SegRes.simOf.data() + 2 * int64_t(begin));
+                    } else {
+                        _sum_h(begin, end, simR.data(), simI.data());
+                    }
+                };
+                const int64_t chunk_size = 1 << 16;
+                int r_begin = 0;
+                while (r_begin < nSources) {
+                    int r_end = r_begin;
+                    int64_t n = 0;
+                    while (r_end < nSources && n < chunk_size) {
+                        n += nSources - r_end;
+                        r_end++;
+                    }
+                    pool.run([&_stream_rows, r_begin, r_end] { _stream_rows(r_begin, r_end); });
+                    r_begin = r_end;
+                }
+            }
+            if (SegRes.storage_mode == 0) {
+                SegRes.nSim = SimReal.nSim + SimImage.nSim;
+                SegRes.hSim.resize(size_t(SegRes.nSim) * nt);
+                SegRes.ratioSim.resize(SegRes.nSim);
+                for (int s=0; s<SegRes.nSim; s++) {
+                    vector<double> &h = s < nReal ? hReal[s] : hImage[s - nReal];
+                    std::copy(h.begin(), h.end(), SegRes.hSim.begin() + size_t(s) * nt);
+                    vector<double>().swap(h);
+                    SegRes.ratioSim[s] = s < nReal ? ratioReal[s] : ratioImage[s - nReal];
+                }  // next s
+            }
+            pool.wait();
+            if (SegRes.storage_mode == 0 && !stream) {
+                SegRes.simOf = std::move(simReal);
+            }
             auto end2 = std::chrono::steady_clock::now();
             if (disp) {
                 double milli = std::chrono::duration_cast<std::chrono::milliseconds>(end2 - end).count();
@@ -185,8 +571,16 @@ namespace gt { namespace heat_transfer {
                 std::cout << "Elapsed time in seconds : "
                           << seconds
                           << " sec" << std::endl;
+                if (options.fls_cache != nullptr) {
+                    std::cout << "FLS kernel cache hits : " << options.fls_cache->hits()
+                              << ", misses : " << options.fls_cache->misses() << std::endl;
+                }
             }
         } else {
+            if (SegRes.storage_mode != 1) {
+                throw std::invalid_argument("The similarity indexed and compressed storage modes require the "
+                                            "similarities.");
+            }
             if (disp) {
                 std::cout << "Calculating segment to segment response factors ..." << std::endl;
             } // end if
@@ -194,35 +588,39 @@ namespace gt { namespace heat_transfer {
             bool sameSegment;
             bool otherSegment;
 
-            auto _fill_line = [&h_ij, &time, &boreSegments](const int i, const int j, const double alpha,
-                    bool sameSegment, bool otherSegment) {
-                auto _dot_product = [&h_ij, &time](const int i, const int j, const double constant) {
-                    for (int k=0; k < time.size(); k++) {
-                        h_ij[j][i][k+1] = constant * h_ij[i][j][k+1];
-                    } // end for
-                };
-                double h;
-                double constant;
+            // the response of segment j on segment i is stored at index (i, j), i <= j; get_h_value scales it for
+            // the response of segment i on segment j
+            auto _fill_line = [&SegRes, &time, &boreSegments, &options, &_n_pruned](const int i, const int j,
+                    const double alpha, bool sameSegment, bool otherSegment) {
                 gt::boreholes::Borehole b1;
                 gt::boreholes::Borehole b2;
                 b2 = boreSegments[i];
-                for (int k = 0; k < time.size(); k++) {
-                    double t = time[k];
-                    if (sameSegment && not otherSegment){
-                        b1 = boreSegments[i];
-                        h = finite_line_source(t, alpha, b2, b2);
-                    } else if (otherSegment && not sameSegment) {
-                        b1 = boreSegments[j];
-                        h = finite_line_source(t, alpha, b1, b2);
-                    } else {
-                        throw std::invalid_argument( "sameSegment and otherSegment cannot both be true" );
-                    } // end if
-                    h_ij[i][j][k+1] = h;
-                    if (otherSegment && not sameSegment) {
-                        constant = double(b2.H / b1.H);
-                        _dot_product(i, j, constant);
-                    } // end if
-                }; // end for
+                if (sameSegment && not otherSegment){
+                    b1 = boreSegments[i];
+                } else if (otherSegment && not sameSegment) {
+                    b1 = boreSegments[j];
+                } else {
+                    throw std::invalid_argument( "sameSegment and otherSegment cannot both be true" );
+                } // end if
+                // FLS solution for combined real and image sources, left 0 at the leading time values at which the
+                // pair is pruned
+                int k0 = _n_pruned(b1.distance(b2));
+                vector<double> timeKept(time.begin() + k0, time.end());
+                vector<double> h(timeKept.size());
+                if (timeKept.empty()) {
+                    return;
+                } else if (options.fls_time_batch) {
+                    finite_line_source(h, timeKept, alpha, b1, b2, true, true, options.fls_vectorize);
+                } else {
+                    for (int k = 0; k < timeKept.size(); k++) {
+                        h[k] = finite_line_source(timeKept[k], alpha, b1, b2, true, true, options.fls_vectorize);
+                    } // end for
+                }
+                int index;
+                SegRes.get_index_value(index, i, j);
+                for (int k = 0; k < timeKept.size(); k++) {
+                    SegRes.slice(k0 + k)[index] = h[k];
+                } // end for
             }; // auto _fill_line
 
             for (int i = 0; i < nSources; i++) {
@@ -230,7 +628,7 @@ namespace gt { namespace heat_transfer {
                 // FLS solution for combined real and image sources
                 sameSegment = true;
                 otherSegment = false;
-                boost::asio::post(pool, [i, alpha, sameSegment, otherSegment, &_fill_line]
+                pool.run([i, alpha, sameSegment, otherSegment, &_fill_line]
                 { _fill_line(i, i, alpha, true, false); });
 //                _fill_line(i, i, alpha, sameSegment, otherSegment); // could call with no threading during debugging
 
@@ -238,14 +636,14 @@ namespace gt { namespace heat_transfer {
                 for (int j = i + 1; j<nSources; j++) {
                     sameSegment = false;
                     otherSegment = true;
-                    boost::asio::post(pool, [i, j, alpha, sameSegment, otherSegment, &_fill_line]
+                    pool.run([i, j, alpha, sameSegment, otherSegment, &_fill_line]
                     { _fill_line(i, j, alpha, sameSegment, otherSegment); });
 //                    _fill_line(i, j, alpha, sameSegment, otherSegment);  // could call with no threading during debugging
                 } // end for
             } // fi (end if)
 
-            /** Wait for all the threads in vector to join **/
-            pool.join();
+            /** Wait for all the tasks to finish **/
+            pool.wait();
             auto end = std::chrono::steady_clock::now();
             if (disp) {
                 double milli = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
@@ -312,19 +710,223 @@ namespace gt { namespace heat_transfer {
 //
 //    }
 
+    SegmentResponse::SegmentResponse(int nSources, int nSum, int nt, int storage_mode) : nSources(nSources),
+            nSum(nSum), nt(nt), boreSegments(nSources), storage_mode(storage_mode) {
+        if (storage_mode < 0 || storage_mode > 2) {
+            throw invalid_argument("The storage mode selected is not currently implemented.");
+        }
+        _allocate();
+    }  // SegmentResponse::SegmentResponse();
+
+    SegmentResponse::SegmentResponse(const SegmentResponse &other) : nSources(other.nSources), nSum(other.nSum),
+            nt(other.nt), nSim(other.nSim), hSim(other.hSim), ratioSim(other.ratioSim), simOf(other.simOf),
+            hMatrix(other.hMatrix), nonZero(other.nonZero), nonZeroRow(other.nonZeroRow), nNonZero(other.nNonZero),
+            dh_ij(other.dh_ij), boreSegments(other.boreSegments), storage_mode(other.storage_mode) {
+        _allocate();
+        if (storage_mode == 1) {
+            std::copy(other.h_ij, other.h_ij + size_t(nt) * nSum, h_ij);
+        }
+    }  // SegmentResponse::SegmentResponse();
+
+    SegmentResponse& SegmentResponse::operator=(const SegmentResponse &other) {
+        if (this != &other) {
+            nSources = other.nSources;
+            nSum = other.nSum;
+            nt = other.nt;
+            nSim = other.nSim;
+            hSim = other.hSim;
+            ratioSim = other.ratioSim;
+            simOf = other.simOf;
+            hMatrix = other.hMatrix;
+            nonZero = other.nonZero;
+            nonZeroRow = other.nonZeroRow;
+            nNonZero = other.nNonZero;
+            dh_ij = other.dh_ij;
+            boreSegments = other.boreSegments;
+            storage_mode = other.storage_mode;
+            _allocate();
+            if (storage_mode == 1) {
+                std::copy(other.h_ij, other.h_ij + size_t(nt) * nSum, h_ij);
+            }
+        }
+        return *this;
+    }  // SegmentResponse::operator=();
+
+    void SegmentResponse::_allocate() {
+        if (storage_mode != 1) {
+            // the response factors are held by hSim
+            h_ij = nullptr;
+            buffer.reset();
+            return;
+        }
+        size_t size = std::max(size_t(nt) * nSum, size_t(1)) * sizeof(double);
+        void *h = boost::alignment::aligned_alloc(64, size);
+        if (h == nullptr) {
+            throw std::bad_alloc();
+        }
+        std::memset(h, 0, size);
+        h_ij = static_cast<double *>(h);
+        buffer.reset(h, boost::alignment::aligned_free);
+    }  // SegmentResponse::_allocate();
+
+    const double* SegmentResponse::time_slice(const int k, double *buffer) {
+        if (storage_mode == 1) {
+            return slice(k);
+        }
+        if (storage_mode == 2) {
+            throw invalid_argument("The compressed response factors are only applied through products "
+                                   "(HMatrix::multiply), not as time slices.");
+        }
+        for (int index=0; index<nSum; index++) {
+            buffer[index] = _similarity_value(index, k);
+        }  // next index
+        return buffer;
+    }  // SegmentResponse::time_slice();
+
+    void SegmentResponse::append(SegmentResponse &later) {
+        if (later.nSum != nSum || later.storage_mode != storage_mode) {
+            throw invalid_argument("The response factors appended are not of the same segments.");
+        }
+        if (storage_mode == 1) {
+            if (nt == 0) {
+                // nothing to copy, the buffer of later is taken over
+                h_ij = later.h_ij;
+                buffer = later.buffer;
+            } else {
+                SegmentResponse combined(nSources, nSum, nt + later.nt, storage_mode);
+                std::copy(h_ij, h_ij + size_t(nt) * nSum, combined.h_ij);
+                std::copy(later.h_ij, later.h_ij + size_t(later.nt) * nSum, combined.slice(nt));
+                h_ij = combined.h_ij;
+                buffer = combined.buffer;
+            }
+        } else if (storage_mode == 2) {
+            if (nt == 0) {
+                hMatrix = later.hMatrix;
+            } else {
+                // the blocks of each time are appended to a copy, copies of this response share the H-matrix
+                hMatrix = std::make_shared<HMatrix>(*hMatrix);
+                hMatrix->append(*later.hMatrix);
+            }
+            later.hMatrix.reset();
+        } else {
+            if (nt == 0) {
+                nSim = later.nSim;
+                hSim.swap(later.hSim);
+                ratioSim.swap(later.ratioSim);
+                simOf.swap(later.simOf);
+            } else {
+                // the similarities only depend on the segments, each curve is extended
+                if (later.nSim != nSim) {
+                    throw invalid_argument("The response factors appended are not of the same similarities.");
+                }
+                vector<double> combined(size_t(nSim) * (nt + later.nt));
+                for (int s=0; s<nSim; s++) {
+                    std::copy(hSim.begin() + size_t(s) * nt, hSim.begin() + size_t(s + 1) * nt,
+                              combined.begin() + size_t(s) * (nt + later.nt));
+                    std::copy(later.hSim.begin() + size_t(s) * later.nt, later.hSim.begin() + size_t(s + 1) * later.nt,
+                              combined.begin() + size_t(s) * (nt + later.nt) + nt);
+                }  // next s
+                hSim.swap(combined);
+            }
+        }
+        nt += later.nt;
+        later.nt = 0;
+        vector<int>().swap(nonZero);
+        vector<int>().swap(nonZeroRow);
+        vector<int>().swap(nNonZero);
+        vector<double>().swap(dh_ij);
+        later._allocate();
+        vector<double>().swap(later.hSim);
+    }  // SegmentResponse::append();
+
+    void SegmentResponse::adopt(double *h, std::shared_ptr<void> owner) {
+        h_ij = h;
+        buffer = std::move(owner);
+    }  // SegmentResponse::adopt();
+
+    void SegmentResponse::index_nonzeros() {
+        if (storage_mode != 1) {
+            throw invalid_argument("The response factors of storage_mode 1 are indexed.");
+        }
+        // the first time each index is not 0
+        vector<int> first(nSum, nt);
+        for (int k=0; k<nt; k++) {
+            const double *h = slice(k);
+            for (int index=0; index<nSum; index++) {
+                if (first[index] == nt && h[index] != 0) {
+                    first[index] = k;
+                }
+            }  // next index
+        }  // next k
+        // counting sort of the indices on that time
+        nNonZero.assign(nt, 0);
+        for (int index=0; index<nSum; index++) {
+            if (first[index] < nt) {
+                nNonZero[first[index]]++;
+            }
+        }  // next index
+        vector<int> position(nt, 0);
+        for (int k=1; k<nt; k++) {
+            position[k] = nNonZero[k - 1];
+            nNonZero[k] += nNonZero[k - 1];
+        }  // next k
+        nonZero.resize(nt > 0 ? nNonZero[nt - 1] : 0);
+        nonZeroRow.resize(nonZero.size());
+        int index = 0;
+        for (int i=0; i<nSources; i++) {
+            for (int j=i; j<nSources; j++, index++) {
+                if (first[index] < nt) {
+                    int n = position[first[index]]++;
+                    nonZero[n] = index;
+                    nonZeroRow[n] = i;
+                }
+            }  // next j
+        }  // next i
+    }  // SegmentResponse::index_nonzeros();
+
+    void SegmentResponse::difference_slices() {
+        if (storage_mode == 2) {
+            throw invalid_argument("The differences of the response factors are stored for storage_mode 0 or 1.");
+        }
+        dh_ij.resize(size_t(nt) * nSum);
+        vector<double> buffer(storage_mode == 1 ? 0 : nSum);
+        vector<double> h_1(nSum, 0.);
+        for (int k=0; k<nt; k++) {
+            const double *h = time_slice(k, buffer.data());
+            double *dh = &dh_ij[size_t(k) * nSum];
+            for (int index=0; index<nSum; index++) {
+                dh[index] = h[index] - h_1[index];
+                h_1[index] = h[index];
+            }  // next index
+        }  // next k
+    }  // SegmentResponse::difference_slices();
+
     void SegmentResponse::get_h_value(double &h, const int i, const int j, const int k) {
         int index;
         switch (storage_mode) {
             case 0 :
-                cout << "Case 0 not written yet" << endl;
+                if (i <= j) {
+                    get_index_value(index, i, j);
+                    h = _similarity_value(index, k);
+                } else {
+                    get_index_value(index, j, i);
+                    h = boreSegments[j].H/boreSegments[i].H * _similarity_value(index, k);
+                }
                 break;
             case 1 :
                 if (i <= j) {
                     get_index_value(index, i, j);
-                    h = h_ij[index][k];
+                    h = h_ij[size_t(k) * nSum + index];
                 } else {
                     get_index_value(index, j, i);
-                    h = boreSegments[j].H/boreSegments[i].H * h_ij[index][k];
+                    h = boreSegments[j].H/boreSegments[i].H * h_ij[size_t(k) * nSum + index];
+                }
+                break;
+            case 2 :
+                if (i <= j) {
+                    h = hMatrix->value(i, j, k);
+                } else {
+                    h = boreSegments[j].H/boreSegments[i].H * hMatrix->value(j, i, k);
                 }
                 break;
             default:
@@ -0,0 +1,452 @@
+#include <cpgfunction/hmatrix.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace gt { namespace heat_transfer {
+
+    namespace {
+        double _diameter(const double *lo, const double *hi) {
+            double d2 = 0;
+            for (int a=0; a<3; a++) {
+                d2 += (hi[a] - lo[a]) * (hi[a] - lo[a]);
+            }
+            return sqrt(d2);
+        }  // _diameter();
+
+        double _box_distance(const double *lo1, const double *hi1, const double *lo2, const double *hi2) {
+            double d2 = 0;
+            for (int a=0; a<3; a++) {
+                double gap = std::max(0., std::max(lo2[a] - hi1[a], lo1[a] - hi2[a]));
+                d2 += gap * gap;
+            }
+            return sqrt(d2);
+        }  // _box_distance();
+    }  // namespace
+
+    HMatrix::HMatrix(std::vector<gt::boreholes::Borehole> &boreSegments, const int nt, const Entry &entry,
+                     const double tol, const double eta, const int leaf_size, gt::parallel::TaskGroup *pool) :
+            nSources(int(boreSegments.size())), nt(nt), tol(tol), eta(eta), leaf_size(leaf_size) {
+        if (leaf_size < 1) {
+            throw std::invalid_argument("The clusters of the H-matrix must hold at least one segment.");
+        }
+        perm.resize(nSources);
+        for (int i=0; i<nSources; i++) {
+            perm[i] = i;
+        }
+        if (nSources > 0) {
+            _cluster(boreSegments, 0, nSources);
+        }
+        position.resize(nSources);
+        leafOf.resize(nSources);
+        leafIndex.assign(clusters.size(), -1);
+        for (int c=0; c<clusters.size(); c++) {
+            if (clusters[c].child[0] < 0) {
+                leafIndex[c] = int(leaves.size());
+                leaves.push_back(c);
+                for (int p=clusters[c].begin; p<clusters[c].end; p++) {
+                    position[perm[p]] = p;
+                    leafOf[perm[p]] = c;
+                }
+            }
+        }  // next c
+
+        // ------ Block partition -------
+        if (nSources > 0) {
+            _partition(0, 0);
+        }
+        // the blocks of the row of each leaf, sorted by the position their columns begin at
+        leafBlocks.resize(leaves.size());
+        for (int b=0; b<blocks.size(); b++) {
+            const Cluster &row = clusters[blocks[b].row];
+            const Cluster &col = clusters[blocks[b].col];
+            // the leaves of a cluster are consecutive in leaves, from the leaf of its first segment
+            for (int l=leafIndex[leafOf[perm[row.begin]]]; l<leaves.size() && clusters[leaves[l]].begin<row.end; l++) {
+                leafBlocks[l].push_back(std::make_pair(col.begin, b));
+            }
+            if (blocks[b].row == blocks[b].col) {
+                continue;
+            }
+            for (int l=leafIndex[leafOf[perm[col.begin]]]; l<leaves.size() && clusters[leaves[l]].begin<col.end; l++) {
+                leafBlocks[l].push_back(std::make_pair(row.begin, -1 - b));
+            }
+        }  // next b
+        for (auto &row : leafBlocks) {
+            std::sort(row.begin(), row.end());
+        }
+
+        // ------ Block approximation -------
+        // the largest entry of each time, the response of a segment on itself
+        std::vector<double> scale(nt, 0.);
+        for (int k=0; k<nt; k++) {
+            for (int i=0; i<nSources; i++) {
+                scale[k] = std::max(scale[k], std::abs(entry(i, i, k)));
+            }
+        }  // next k
+        for (auto &block : blocks) {
+            if (pool != nullptr) {
+                Block *b = &block;
+                pool->run([this, b, &entry, &scale] { _approximate(*b, entry, scale); });
+            } else {
+                _approximate(block, entry, scale);
+            }
+        }  // next block
+        if (pool != nullptr) {
+            pool->wait();
+        }
+    }  // HMatrix::HMatrix();
+
+    int HMatrix::_cluster(std::vector<gt::boreholes::Borehole> &boreSegments, const int begin, const int end) {
+        Cluster cluster;
+        cluster.begin = begin;
+        cluster.end = end;
+        cluster.child[0] = -1;
+        cluster.child[1] = -1;
+        for (int a=0; a<3; a++) {
+            cluster.lo[a] = std::numeric_limits<double>::infinity();
+            cluster.hi[a] = -std::numeric_limits<double>::infinity();
+        }
+        for (int p=begin; p<end; p++) {
+            gt::boreholes::Borehole &b = boreSegments[perm[p]];
+            cluster.lo[0] = std::min(cluster.lo[0], b.x);
+            cluster.hi[0] = std::max(cluster.hi[0], b.x);
+            cluster.lo[1] = std::min(cluster.lo[1], b.y);
+            cluster.hi[1] = std::max(cluster.hi[1], b.y);
+            cluster.lo[2] = std::min(cluster.lo[2], b.D);
+            cluster.hi[2] = std::max(cluster.hi[2], b.D + b.H);
+        }  // next p
+        int id = int(clusters.size());
+        clusters.push_back(cluster);
+        if (end - begin <= leaf_size) {
+            return id;
+        }
+        // bisect the longest side of the box at the median of the segment centers
+        int axis = 0;
+        for (int a=1; a<3; a++) {
+            if (cluster.hi[a] - cluster.lo[a] > cluster.hi[axis] - cluster.lo[axis]) {
+                axis = a;
+            }
+        }
+        auto _center = [&boreSegments, axis](const int i) {
+            gt::boreholes::Borehole &b = boreSegments[i];
+            return axis == 0 ? b.x : (axis == 1 ? b.y : b.D + b.H / 2);
+        };
+        int mid = (begin + end) / 2;
+        std::nth_element(perm.begin() + begin, perm.begin() + mid, perm.begin() + end,
+                         [&_center](const int i, const int j) { return _center(i) < _center(j); });
+        int child0 = _cluster(boreSegments, begin, mid);
+        int child1 = _cluster(boreSegments, mid, end);
+        clusters[id].child[0] = child0;
+        clusters[id].child[1] = child1;
+        return id;
+    }  // HMatrix::_cluster();
+
+    void HMatrix::_partition(const int row, const int col) {
+        const Cluster &r = clusters[row];
+        const Cluster &c = clusters[col];
+        bool rowLeaf = r.child[0] < 0;
+        bool colLeaf = c.child[0] < 0;
+        bool admissible = row != col && std::min(_diameter(r.lo, r.hi), _diameter(c.lo, c.hi))
+                <= eta * _box_distance(r.lo, r.hi, c.lo, c.hi);
+        if (admissible || (rowLeaf && colLeaf)) {
+            Block block;
+            block.row = row;
+            block.col = col;
+            block.admissible = admissible;
+            blocks.push_back(std::move(block));
+        } else if (row == col) {
+            // only the blocks on and above the diagonal
+            _partition(r.child[0], r.child[0]);
+            _partition(r.child[0], r.child[1]);
+            _partition(r.child[1], r.child[1]);
+        } else if (rowLeaf) {
+            _partition(row, c.child[0]);
+            _partition(row, c.child[1]);
+        } else if (colLeaf) {
+            _partition(r.child[0], col);
+            _partition(r.child[1], col);
+        } else {
+            for (int a=0; a<2; a++) {
+                for (int b=0; b<2; b++) {
+                    _partition(r.child[a], c.child[b]);
+                }
+            }
+        }
+    }  // HMatrix::_partition();
+
+    void HMatrix::_approximate(Block &block, const Entry &entry, const std::vector<double> &scale) {
+        const Cluster &row = clusters[block.row];
+        const Cluster &col = clusters[block.col];
+        int n1 = row.end - row.begin;
+        int n2 = col.end - col.begin;
+        block.rank.assign(nt, -1);
+        block.offset.assign(nt + 1, 0);
+        block.data.clear();
+
+        std::vector<double> U;
+        std::vector<double> V;
+        std::vector<double> u(n1);
+        std::vector<double> v(n2);
+        std::vector<bool> rowUsed(n1);
+        for (int k=0; k<nt; k++) {
+            auto _S = [&](const int a, const int b) {
+                int i = perm[row.begin + a];
+                int j = perm[col.begin + b];
+                return i <= j ? entry(i, j, k) : entry(j, i, k);
+            };
+            int rank = -1;
+            if (block.admissible) {
+                // adaptive cross approximation with partial pivoting, at most the rank that stores less than the
+                // dense block
+                U.clear();
+                V.clear();
+                std::fill(rowUsed.begin(), rowUsed.end(), false);
+                double norm2 = 0;
+                int r = 0;
+                int iPivot = 0;
+                bool converged = false;
+                while (r * (n1 + n2) < n1 * n2) {
+                    // the residual of row iPivot
+                    rowUsed[iPivot] = true;
+                    int jPivot = 0;
+                    for (int b=0; b<n2; b++) {
+                        double value = _S(iPivot, b);
+                        for (int l=0; l<r; l++) {
+                            value -= U[l * n1 + iPivot] * V[l * n2 + b];
+                        }
+                        v[b] = value;
+                        if (std::abs(value) > std::abs(v[jPivot])) {
+                            jPivot = b;
+                        }
+                    }  // next b
+                    if (std::abs(v[jPivot]) <= tol * scale[k]) {
+                        // the row is already approximated, the next row not used yet
+                        iPivot = int(std::find(rowUsed.begin(), rowUsed.end(), false) - rowUsed.begin());
+                        if (iPivot == n1) {
+                            converged = true;
+                            break;
+                        }
+                        continue;
+                    }
+                    double pivot = v[jPivot];
+                    for (int b=0; b<n2; b++) {
+                        v[b] /= pivot;
+                    }
+                    // the residual of column jPivot
+                    for (int a=0; a<n1; a++) {
+                        double value = _S(a, jPivot);
+                        for (int l=0; l<r; l++) {
+                            value -= U[l * n1 + a] * V[l * n2 + jPivot];
+                        }
+                        u[a] = value;
+                    }  // next a
+                    // the Frobenius norm of the approximation, ||S_r||^2 = ||S_r-1||^2 + 2 sum_l (u.u_l)(v.v_l)
+                    // + |u|^2 |v|^2
+                    double uu = 0;
+                    double vv = 0;
+                    for (int a=0; a<n1; a++) {
+                        uu += u[a] * u[a];
+                    }
+                    for (int b=0; b<n2; b++) {
+                        vv += v[b] * v[b];
+                    }
+                    for (int l=0; l<r; l++) {
+                        double uu_l = 0;
+                        double vv_l = 0;
+                        for (int a=0; a<n1; a++) {
+                            uu_l += u[a] * U[l * n1 + a];
+                        }
+                        for (int b=0; b<n2; b++) {
+                            vv_l += v[b] * V[l * n2 + b];
+                        }
+                        norm2 += 2 * uu_l * vv_l;
+                    }  // next l
+                    norm2 += uu * vv;
+                    U.insert(U.end(), u.begin(), u.end());
+                    V.insert(V.end(), v.begin(), v.end());
+                    r++;
+                    double u_max = 0;
+                    for (int a=0; a<n1; a++) {
+                        u_max = std::max(u_max, std::abs(u[a]));
+                    }
+                    if (sqrt(uu * vv) <= tol * sqrt(std::max(norm2, 0.)) || u_max <= tol * scale[k]) {
+                        converged = true;
+                        break;
+                    }
+                    // the next row is the one of the largest entry of the column not used yet
+                    iPivot = -1;
+                    for (int a=0; a<n1; a++) {
+                        if (!rowUsed[a] && (iPivot < 0 || std::abs(u[a]) > std::abs(u[iPivot]))) {
+                            iPivot = a;
+                        }
+                    }  // next a
+                    if (iPivot < 0) {
+                        converged = true;
+                        break;
+                    }
+                }  // while (r);
+                if (converged) {
+                    rank = r;
+                    block.data.insert(block.data.end(), U.begin(), U.end());
+                    block.data.insert(block.data.end(), V.begin(), V.end());
+                }
+            }
+            if (rank < 0) {
+                for (int a=0; a<n1; a++) {
+                    for (int b=0; b<n2; b++) {
+                        block.data.push_back(_S(a, b));
+                    }
+                }  // next a
+            }
+            block.rank[k] = rank;
+            block.offset[k + 1] = block.data.size();
+        }  // next k
+        block.data.shrink_to_fit();
+    }  // HMatrix::_approximate();
+
+    double HMatrix::value(int i, int j, const int k) const {
+        // the last block of the row of the leaf of i beginning at or before j
+        const std::vector<std::pair<int, int> > &row_blocks = leafBlocks[leafIndex[leafOf[i]]];
+        int code = (std::upper_bound(row_blocks.begin(), row_blocks.end(),
+                                     std::make_pair(position[j], std::numeric_limits<int>::max())) - 1)->second;
+        if (code < 0) {
+            // S is symmetric, the entry is read from the stored block
+            std::swap(i, j);
+            code = -1 - code;
+        }
+        const Block &block = blocks[code];
+        const Cluster &row = clusters[block.row];
+        const Cluster &col = clusters[block.col];
+        int n1 = row.end - row.begin;
+        int n2 = col.end - col.begin;
+        int a = position[i] - row.begin;
+        int b = position[j] - col.begin;
+        const double *data = block.data.data() + block.offset[k];
+        int rank = block.rank[k];
+        if (rank < 0) {
+            return data[size_t(a) * n2 + b];
+        }
+        double h = 0;
+        for (int l=0; l<rank; l++) {
+            h += data[l * n1 + a] * data[rank * n1 + l * n2 + b];
+        }
+        return h;
+    }  // HMatrix::value();
+
+    void HMatrix::multiply(const int k, const double alpha, const double *x, double *y) const {
+        // in cluster order
+        std::vector<double> xp(nSources);
+        std::vector<double> yp(nSources, 0.);
+        for (int p=0; p<nSources; p++) {
+            xp[p] = x[perm[p]];
+        }
+        std::vector<double> t;
+        for (auto &block : blocks) {
+            const Cluster &row = clusters[block.row];
+            const Cluster &col = clusters[block.col];
+            int n1 = row.end - row.begin;
+            int n2 = col.end - col.begin;
+            const double *x1 = xp.data() + row.begin;
+            const double *x2 = xp.data() + col.begin;
+            double *y1 = yp.data() + row.begin;
+            double *y2 = yp.data() + col.begin;
+            bool transpose = block.row != block.col;
+            const double *data = block.data.data() + block.offset[k];
+            int rank = block.rank[k];
+            if (rank < 0) {
+                for (int a=0; a<n1; a++) {
+                    const double *S_a = data + size_t(a) * n2;
+                    double s = 0;
+                    for (int b=0; b<n2; b++) {
+                        s += S_a[b] * x2[b];
+                    }
+                    y1[a] += s;
+                    if (transpose) {
+                        for (int b=0; b<n2; b++) {
+                            y2[b] += S_a[b] * x1[a];
+                        }
+                    }
+                }  // next a
+            } else {
+                const double *U = data;
+                const double *V = data + size_t(rank) * n1;
+                // y1 = y1 + U V^T x2 and y2 = y2 + V U^T x1
+                for (int l=0; l<rank; l++) {
+                    double s1 = 0;
+                    double s2 = 0;
+                    for (int b=0; b<n2; b++) {
+                        s1 += V[l * n2 + b] * x2[b];
+                    }
+                    for (int a=0; a<n1; a++) {
+                        s2 += U[l * n1 + a] * x1[a];
+                    }
+                    for (int a=0; a<n1; a++) {
+                        y1[a] += U[l * n1 + a] * s1;
+                    }
+                    for (int b=0; b<n2; b++) {
+                        y2[b] += V[l * n2 + b] * s2;
+                    }
+                }  // next l
+            }
+        }  // next block
+        for (int p=0; p<nSources; p++) {
+            y[perm[p]] += alpha * yp[p];
+        }
+    }  // HMatrix::multiply();
+
+    void HMatrix::append(HMatrix &later) {
+        if (later.nSources != nSources || later.perm != perm || later.blocks.size() != blocks.size()) {
+            throw std::invalid_argument("The H-matrices appended are not of the same segments.");
+        }
+        for (int b=0; b<blocks.size(); b++) {
+            Block &block = blocks[b];
+            Block &next = later.blocks[b];
+            size_t size = block.data.size();
+            block.rank.insert(block.rank.end(), next.rank.begin(), next.rank.end());
+            for (int k=1; k<=later.nt; k++) {
+                block.offset.push_back(size + next.offset[k]);
+            }
+            block.data.insert(block.data.end(), next.data.begin(), next.data.end());
+            std::vector<double>().swap(next.data);
+        }  // next b
+        nt += later.nt;
+        later.nt = 0;
+    }  // HMatrix::append();
+
+    size_t HMatrix::bytes() const {
+        size_t size = (perm.size() + position.size() + leafOf.size() + leafIndex.size() + leaves.size())
+                * sizeof(int) + clusters.size() * sizeof(Cluster);
+        for (auto &row : leafBlocks) {
+            size += row.size() * sizeof(std::pair<int, int>);
+        }
+        for (auto &block : blocks) {
+            size += sizeof(Block) + block.rank.size() * sizeof(int) + block.offset.size() * sizeof(size_t)
+                    + block.data.size() * sizeof(double);
+        }
+        return size;
+    }  // HMatrix::bytes();
+
+    int HMatrix::nLowRank() const {
+        int n = 0;
+        for (auto &block : blocks) {
+            n += block.admissible;
+        }
+        return n;
+    }  // HMatrix::nLowRank();
+
+    double HMatrix::meanRank() const {
+        double sum = 0;
+        long n = 0;
+        for (auto &block : blocks) {
+            for (int k=0; k<nt; k++) {
+                if (block.admissible && block.rank[k] >= 0) {
+                    sum += block.rank[k];
+                    n++;
+                }
+            }  // next k
+        }  // next block
+        return n > 0 ? sum / double(n) : 0.;
+    }  // HMatrix::meanRank();
+
+} } // namespace gt::heat_transfer
@@ -54,37 +54,22 @@ namespace jcc { namespace interpolation {
         } // next j
     } // interp1d
 
-    void interp1d(double &xp, double &yp, vector<double> &time,
-                  gt::heat_transfer::SegmentResponse &SegRes, int &i, int &j, int &k) {
-        // if the x point is out of bounds, then tell the user that extrapolation is not possible
+    void interp_weights(const double xp, vector<double> &time, int &k, double &w0, double &w1) {
         if (xp < 0 || xp > time[time.size()-1]) {
             throw invalid_argument("Need to add extrapolation");
         }
-        // if the time value falls in between 0 and the first time value, then interpolate 0 to t1
-        if (0 < xp && xp < time[0]) {
-            double h;
-            SegRes.get_h_value(h, i, j, k);
-            yp = linterp(xp, 0, 0, time[0], h);
+        k = 0;
+        if (xp <= time[0]) {
+            w0 = xp / time[0];
+            w1 = 0;
             return;
         }
-        // loop until the value for interpolation is found
-        int counter=0;
-        double h1;
-        SegRes.get_h_value(h1, i, j, 0);
-        double h2;
-        SegRes.get_h_value(h2, i, j, 1);
-        for (int k=counter; k<time.size()-1; k++) {
-            if (xp>=time[k] && xp <=time[k+1]) {
-                yp = linterp(xp, time[k], h1, time[k+1], h2);
-                return;
-            } else {
-                counter++;
-                h1 = h2;
-                SegRes.get_h_value(h2, i, j, counter+1);
-            }  // else()
-
-        }  // next k
-    }  // interp1d();
+        while (k < time.size() - 2 && xp > time[k+1]) {
+            k++;
+        }
+        w1 = (xp - time[k]) / (time[k+1] - time[k]);
+        w0 = 1 - w1;
+    }  // interp_weights();
 
 } } // jcc::interpolation
 
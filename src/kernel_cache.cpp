@@ -0,0 +1,116 @@
+#include <cpgfunction/kernel_cache.h>
+#include <cmath>
+
+namespace gt { namespace heat_transfer {
+
+    FLSKernelCache::FLSKernelCache(const double rel_quantum, const size_t capacity) : rel_quantum(rel_quantum),
+            capacity(capacity), nHits(0), nMisses(0) {
+    }  // FLSKernelCache::FLSKernelCache();
+
+    FLSKernelCache& FLSKernelCache::instance() {
+        static FLSKernelCache cache(1.0e-9, shared_capacity);
+        return cache;
+    }  // FLSKernelCache::instance();
+
+    bool FLSKernelCache::Key::operator==(const Key &other) const {
+        for (int i=0; i<6; i++) {
+            if (q[i] != other.q[i]) {
+                return false;
+            }
+        }
+        return true;
+    }  // FLSKernelCache::Key::operator==();
+
+    size_t FLSKernelCache::KeyHash::operator()(const Key &key) const {
+        // FNV-1a over the quantized groups
+        uint64_t hash = 14695981039346656037ULL;
+        for (int i=0; i<6; i++) {
+            hash ^= uint64_t(key.q[i]);
+            hash *= 1099511628211ULL;
+        }
+        return size_t(hash);
+    }  // FLSKernelCache::KeyHash::operator();
+
+    void FLSKernelCache::_keys(std::vector<Key> &keys, std::vector<double> &time, const double alpha,
+                               gt::boreholes::Borehole &b1, gt::boreholes::Borehole &b2, const bool reaSource,
+                               const bool imgSource) {
+        const double log_quantum = std::log1p(rel_quantum);
+        // positive groups are quantized on a logarithmic scale (relative resolution)
+        auto _relative = [log_quantum](const double v) {
+            return int64_t(std::llround(std::log(v) / log_quantum));
+        };
+        // depth offsets can be zero or negative and are quantized on a linear scale
+        auto _absolute = [this](const double v) {
+            return int64_t(std::llround(v / rel_quantum));
+        };
+        const int64_t unused = INT64_MIN;
+
+        double H2 = b2.H;
+        Key key;
+        key.q[0] = int64_t(reaSource) + 2 * int64_t(imgSource);
+        key.q[1] = _relative(b1.distance(b2) / H2);
+        key.q[2] = _relative(b1.H / H2);
+        key.q[3] = reaSource ? _absolute((b2.D - b1.D) / H2) : unused;
+        key.q[4] = imgSource ? _absolute((b2.D + b1.D) / H2) : unused;
+
+        keys.resize(time.size());
+        for (int k=0; k<time.size(); k++) {
+            keys[k] = key;
+            keys[k].q[5] = _relative(alpha * time[k] / (H2 * H2));
+        }
+    }  // FLSKernelCache::_keys();
+
+    int FLSKernelCache::find(std::vector<double> &h, std::vector<bool> &found, std::vector<double> &time,
+                             const double alpha, gt::boreholes::Borehole &b1, gt::boreholes::Borehole &b2,
+                             const bool reaSource, const bool imgSource) {
+        std::vector<Key> keys;
+        _keys(keys, time, alpha, b1, b2, reaSource, imgSource);
+        int nt = time.size();
+        h.resize(nt);
+        found.assign(nt, false);
+        int nFound = 0;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            for (int k=0; k<nt; k++) {
+                auto it = values.find(keys[k]);
+                if (it != values.end()) {
+                    h[k] = it->second;
+                    found[k] = true;
+                    nFound++;
+                }
+            }  // next k
+        }
+        nHits += nFound;
+        nMisses += nt - nFound;
+        return nFound;
+    }  // FLSKernelCache::find();
+
+    void FLSKernelCache::insert(std::vector<double> &h, std::vector<bool> &found, std::vector<double> &time,
+                                const double alpha, gt::boreholes::Borehole &b1, gt::boreholes::Borehole &b2,
+                                const bool reaSource, const bool imgSource) {
+        std::vector<Key> keys;
+        _keys(keys, time, alpha, b1, b2, reaSource, imgSource);
+        std::lock_guard<std::mutex> lock(mtx);
+        if (capacity > 0 && values.size() + time.size() > capacity) {
+            values.clear();
+        }
+        for (int k=0; k<time.size(); k++) {
+            if (!found[k]) {
+                values.emplace(keys[k], h[k]);
+            }
+        }  // next k
+    }  // FLSKernelCache::insert();
+
+    size_t FLSKernelCache::size() {
+        std::lock_guard<std::mutex> lock(mtx);
+        return values.size();
+    }  // FLSKernelCache::size();
+
+    void FLSKernelCache::clear() {
+        std::lock_guard<std::mutex> lock(mtx);
+        values.clear();
+        nHits = 0;
+        nMisses = 0;
+    }  // FLSKernelCache::clear();
+
+} } // namespace gt::heat_transfer
@@ -0,0 +1,208 @@
+#include <cpgfunction/response_store.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <iomanip>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace gt { namespace heat_transfer {
+
+    namespace {
+        const char MAGIC[8] = {'C', 'P', 'G', 'F', 'H', 'I', 'J', '2'};
+        const int64_t ALIGNMENT = 64;
+
+        struct Header {
+            char magic[8];
+            uint64_t key;
+            int64_t nSegments;
+            int64_t nSources;
+            int64_t nSum;
+            int64_t nt;
+            double alpha;
+            ResponseSettings settings;
+            int64_t data_offset;  // byte offset of the response factors
+        };  // struct Header
+
+        // H, D, r_b, x, y of every segment
+        void _geometry(std::vector<double> &geometry, std::vector<gt::boreholes::Borehole> &boreSegments) {
+            geometry.resize(5 * boreSegments.size());
+            for (int i=0; i<boreSegments.size(); i++) {
+                geometry[5 * i] = boreSegments[i].H;
+                geometry[5 * i + 1] = boreSegments[i].D;
+                geometry[5 * i + 2] = boreSegments[i].r_b;
+                geometry[5 * i + 3] = boreSegments[i].x;
+                geometry[5 * i + 4] = boreSegments[i].y;
+            }  // next i
+        }  // _geometry();
+
+        int64_t _data_offset(const int64_t nt, const int64_t nGeometry) {
+            int64_t offset = sizeof(Header) + (nt + nGeometry) * sizeof(double);
+            return (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+        }  // _data_offset();
+
+        // Writes the n bytes of data to fd, returns false when they are not all written
+        bool _write(const int fd, const void *data, size_t n) {
+            const char *bytes = static_cast<const char *>(data);
+            while (n > 0) {
+                ssize_t written = write(fd, bytes, n);
+                if (written < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (written <= 0) {
+                    return false;
+                }
+                bytes += written;
+                n -= written;
+            }
+            return true;
+        }  // _write();
+    }  // namespace
+
+    ResponseSettings::ResponseSettings(const gt::options::Options &options, const bool use_similarities,
+                                       const int storage_mode) : use_similarities(use_similarities),
+            fls_time_batch(options.fls_time_batch), fls_vectorize(options.fls_vectorize),
+            fls_cache(options.fls_cache != nullptr), storage_mode(storage_mode), fls_prune_tol(options.fls_prune_tol) {
+    }  // ResponseSettings::ResponseSettings();
+
+    bool ResponseSettings::operator==(const ResponseSettings &other) const {
+        return use_similarities == other.use_similarities && fls_time_batch == other.fls_time_batch
+                && fls_vectorize == other.fls_vectorize && fls_cache == other.fls_cache
+                && storage_mode == other.storage_mode && fls_prune_tol == other.fls_prune_tol;
+    }  // ResponseSettings::operator==();
+
+    ResponseFactorStore::ResponseFactorStore(const std::string &directory) : directory(directory) {
+    }  // ResponseFactorStore::ResponseFactorStore();
+
+    uint64_t ResponseFactorStore::key(std::vector<gt::boreholes::Borehole> &boreSegments, std::vector<double> &time,
+                                      const double alpha, const int nSegments, const ResponseSettings &settings) {
+        // FNV-1a over the bytes of the inputs
+        uint64_t hash = 14695981039346656037ULL;
+        auto _hash = [&hash](const void *data, const size_t n) {
+            const unsigned char *bytes = static_cast<const unsigned char *>(data);
+            for (size_t i=0; i<n; i++) {
+                hash ^= bytes[i];
+                hash *= 1099511628211ULL;
+            }
+        };
+        std::vector<double> geometry;
+        _geometry(geometry, boreSegments);
+        int64_t n[3] = {int64_t(nSegments), int64_t(boreSegments.size()), int64_t(time.size())};
+        _hash(n, sizeof(n));
+        _hash(&alpha, sizeof(alpha));
+        int64_t flags[5] = {settings.use_similarities, settings.fls_time_batch, settings.fls_vectorize,
+                            settings.fls_cache, settings.storage_mode};
+        _hash(flags, sizeof(flags));
+        _hash(&settings.fls_prune_tol, sizeof(settings.fls_prune_tol));
+        _hash(time.data(), time.size() * sizeof(double));
+        _hash(geometry.data(), geometry.size() * sizeof(double));
+        return hash;
+    }  // ResponseFactorStore::key();
+
+    std::string ResponseFactorStore::path(const uint64_t key) const {
+        std::ostringstream name;
+        name << directory << "/" << std::hex << std::setw(16) << std::setfill('0') << key << ".hij";
+        return name.str();
+    }  // ResponseFactorStore::path();
+
+    bool ResponseFactorStore::load(SegmentResponse &SegRes, std::vector<gt::boreholes::Borehole> &boreSegments,
+                                   std::vector<double> &time, const double alpha, const int nSegments,
+                                   const ResponseSettings &settings) const {
+        uint64_t k = key(boreSegments, time, alpha, nSegments, settings);
+        int fd = open(path(k).c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size < sizeof(Header)) {
+            close(fd);
+            return false;
+        }
+        // a private mapping: the response factors are used in place, any write stays in memory
+        void *map = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        close(fd);  // the mapping stays valid
+        if (map == MAP_FAILED) {
+            return false;
+        }
+
+        const char *bytes = static_cast<const char *>(map);
+        const Header *header = reinterpret_cast<const Header *>(bytes);
+        int64_t nSources = boreSegments.size();
+        int64_t nt = time.size();
+        std::vector<double> geometry;
+        _geometry(geometry, boreSegments);
+        int64_t data_offset = _data_offset(nt, geometry.size());
+        bool valid = std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) == 0 && header->key == k
+                && header->nSegments == nSegments && header->nSources == nSources && header->nSum == SegRes.nSum
+                && header->nt == nt && header->alpha == alpha && header->settings == settings
+                && header->data_offset == data_offset
+                && st.st_size == data_offset + nt * SegRes.nSum * int64_t(sizeof(double));
+        if (valid) {
+            // compare the inputs in case of a hash collision
+            const double *stored = reinterpret_cast<const double *>(bytes + sizeof(Header));
+            valid = std::memcmp(stored, time.data(), nt * sizeof(double)) == 0
+                    && std::memcmp(stored + nt, geometry.data(), geometry.size() * sizeof(double)) == 0;
+        }
+        if (!valid) {
+            munmap(map, st.st_size);
+            return false;
+        }
+        // the layout of the file is the layout of SegmentResponse::h_ij, so the mapping is used without a copy
+        size_t size = st.st_size;
+        SegRes.adopt(reinterpret_cast<double *>(static_cast<char *>(map) + data_offset),
+                     std::shared_ptr<void>(map, [size](void *p) { munmap(p, size); }));
+        return true;
+    }  // ResponseFactorStore::load();
+
+    void ResponseFactorStore::save(SegmentResponse &SegRes, std::vector<gt::boreholes::Borehole> &boreSegments,
+                                   std::vector<double> &time, const double alpha, const int nSegments,
+                                   const ResponseSettings &settings) const {
+        if (mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST) {
+            throw std::runtime_error("Unable to create the response factor store " + directory);
+        }
+        uint64_t k = key(boreSegments, time, alpha, nSegments, settings);
+        std::vector<double> geometry;
+        _geometry(geometry, boreSegments);
+        int nt = time.size();
+        int nSum = SegRes.nSum;
+
+        Header header;
+        std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.key = k;
+        header.nSegments = nSegments;
+        header.nSources = boreSegments.size();
+        header.nSum = nSum;
+        header.nt = nt;
+        header.alpha = alpha;
+        header.settings = settings;
+        header.data_offset = _data_offset(nt, geometry.size());
+
+        std::string final_path = path(k);
+        // a temporary file of its own for every writer, the threads of a batch can save the same table at once
+        std::vector<char> temporary_path(final_path.begin(), final_path.end());
+        const char suffix[] = ".XXXXXX";
+        temporary_path.insert(temporary_path.end(), suffix, suffix + sizeof(suffix));
+        int fd = mkstemp(temporary_path.data());
+        if (fd < 0) {
+            throw std::runtime_error("Unable to write the response factors to " + final_path);
+        }
+        std::vector<char> padding(header.data_offset - sizeof(Header) - (nt + geometry.size()) * sizeof(double), 0);
+        // the table is synced before the rename, so that a crash never leaves a truncated table under its name
+        bool written = fchmod(fd, 0644) == 0 && _write(fd, &header, sizeof(Header))
+                && _write(fd, time.data(), nt * sizeof(double))
+                && _write(fd, geometry.data(), geometry.size() * sizeof(double))
+                && _write(fd, padding.data(), padding.size())
+                && _write(fd, SegRes.h_ij, size_t(nt) * nSum * sizeof(double))
+                && fsync(fd) == 0;
+        written = close(fd) == 0 && written;
+        if (!written || std::rename(temporary_path.data(), final_path.c_str()) != 0) {
+            std::remove(temporary_path.data());
+            throw std::runtime_error("Unable to write the response factors to " + final_path);
+        }
+    }  // ResponseFactorStore::save();
+
+} } // namespace gt::heat_transfer
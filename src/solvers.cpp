@@ -0,0 +1,122 @@
+#include <cpgfunction/solvers.h>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace gt { namespace solvers {
+
+    namespace {
+        double _dot(const std::vector<double> &x, const std::vector<double> &y) {
+            double s = 0;
+            for (int i=0; i<x.size(); i++) {
+                s += x[i] * y[i];
+            }
+            return s;
+        }  // _dot();
+    }  // namespace
+
+    int gmres(const LinearOperator &A, const LinearOperator &M, const std::vector<double> &b, std::vector<double> &x,
+              const double tol, const int restart, const int max_iterations) {
+        int n = int(b.size());
+        if (int(x.size()) != n) {
+            throw std::invalid_argument("The initial guess is not of the size of the system.");
+        }
+        double b_norm = sqrt(_dot(b, b));
+        if (b_norm == 0) {
+            std::fill(x.begin(), x.end(), 0.);
+            return 0;
+        }
+        int m = std::max(1, std::min(restart, n));
+        std::vector<std::vector<double>> V(m + 1, std::vector<double>(n));
+        std::vector<double> H((m + 1) * m);  // column-major, (m + 1) x m
+        std::vector<double> cs(m);
+        std::vector<double> sn(m);
+        std::vector<double> g(m + 1);
+        std::vector<double> y(m);
+        std::vector<double> z(n);
+        std::vector<double> w(n);
+
+        int iterations = 0;
+        while (true) {
+            // r = b - A x
+            A(x.data(), w.data());
+            for (int i=0; i<n; i++) {
+                V[0][i] = b[i] - w[i];
+            }
+            double beta = sqrt(_dot(V[0], V[0]));
+            if (beta <= tol * b_norm) {
+                return iterations;
+            }
+            if (iterations >= max_iterations) {
+                throw std::runtime_error("GMRES did not converge in the maximum number of iterations.");
+            }
+            for (int i=0; i<n; i++) {
+                V[0][i] /= beta;
+            }
+            std::fill(g.begin(), g.end(), 0.);
+            g[0] = beta;
+
+            int j = 0;
+            for (; j<m && iterations<max_iterations; j++) {
+                iterations++;
+                // w = A M^-1 v_j, orthogonalized against v_0, ..., v_j (modified Gram-Schmidt)
+                M(V[j].data(), z.data());
+                A(z.data(), w.data());
+                for (int l=0; l<=j; l++) {
+                    double h = _dot(w, V[l]);
+                    H[j * (m + 1) + l] = h;
+                    for (int i=0; i<n; i++) {
+                        w[i] -= h * V[l][i];
+                    }
+                }  // next l
+                double h_next = sqrt(_dot(w, w));
+                H[j * (m + 1) + j + 1] = h_next;
+                if (h_next > 0) {
+                    for (int i=0; i<n; i++) {
+                        V[j + 1][i] = w[i] / h_next;
+                    }
+                }
+                // the Givens rotations of the previous columns, then the one that zeroes H(j + 1, j)
+                for (int l=0; l<j; l++) {
+                    double h1 = H[j * (m + 1) + l];
+                    double h2 = H[j * (m + 1) + l + 1];
+                    H[j * (m + 1) + l] = cs[l] * h1 + sn[l] * h2;
+                    H[j * (m + 1) + l + 1] = -sn[l] * h1 + cs[l] * h2;
+                }  // next l
+                double h1 = H[j * (m + 1) + j];
+                double h2 = H[j * (m + 1) + j + 1];
+                double r = sqrt(h1 * h1 + h2 * h2);
+                cs[j] = r > 0 ? h1 / r : 1.;
+                sn[j] = r > 0 ? h2 / r : 0.;
+                H[j * (m + 1) + j] = r;
+                H[j * (m + 1) + j + 1] = 0;
+                g[j + 1] = -sn[j] * g[j];
+                g[j] = cs[j] * g[j];
+                if (std::abs(g[j + 1]) <= tol * b_norm || h_next == 0) {
+                    j++;
+                    break;
+                }
+            }  // next j
+
+            // x = x + M^-1 V y, H y = g being upper triangular
+            for (int l=j-1; l>=0; l--) {
+                double s = g[l];
+                for (int c=l+1; c<j; c++) {
+                    s -= H[c * (m + 1) + l] * y[c];
+                }
+                y[l] = s / H[l * (m + 1) + l];
+            }  // next l
+            std::fill(w.begin(), w.end(), 0.);
+            for (int l=0; l<j; l++) {
+                for (int i=0; i<n; i++) {
+                    w[i] += y[l] * V[l][i];
+                }
+            }  // next l
+            M(w.data(), z.data());
+            for (int i=0; i<n; i++) {
+                x[i] += z[i];
+            }
+        }  // while (true);
+    }  // gmres();
+
+} } // namespace gt::solvers
@@ -0,0 +1,88 @@
+// Computes a batch of bore fields (rectangles of different sizes, spacings, depths and diffusivities) with the
+// batch API and with a loop over uniform_borehole_wall_temperature, verifies that the g-functions agree and reports
+// the throughput of both in configurations per hour
+
+#include <cpgfunction/coordinates.h>
+#include <cpgfunction/boreholes.h>
+#include <cpgfunction/utilities.h>
+#include <cpgfunction/gfunction.h>
+#include <cpgfunction/options.h>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+
+
+int main() {
+    double D = 4.;
+    double r_b = 0.075;
+
+    std::vector<gt::gfunction::BoreFieldDefinition> fields;
+    for (int N : {3, 4, 5}) {
+        for (double B : {5., 7.5}) {
+            for (double H : {100., 150.}) {
+                gt::gfunction::BoreFieldDefinition field;
+                field.coordinates = gt::coordinates::configuration("Rectangle", N, N, B, B);
+                field.H = H;
+                field.D = D;
+                field.r_b = r_b;
+                field.alpha = H > 120. ? 1.2e-06 : 1.0e-06;
+                field.time = gt::utilities::time_Eskilson(H, field.alpha);
+                field.nSegments = 8;
+                fields.push_back(field);
+            }  // next H
+        }  // next B
+    }  // next N
+    int nFields = int(fields.size());
+
+    auto _seconds = [](std::chrono::steady_clock::time_point start) {
+        auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1.0e6;
+    };
+
+    // one field after the other
+    std::vector<std::vector<double>> g_loop(nFields);
+    auto start = std::chrono::steady_clock::now();
+    for (int i=0; i<nFields; i++) {
+        std::vector<gt::boreholes::Borehole> boreField = gt::boreholes::boreField(
+                fields[i].coordinates, fields[i].r_b, fields[i].H, fields[i].D);
+        g_loop[i] = gt::gfunction::uniform_borehole_wall_temperature(
+                boreField, fields[i].time, fields[i].alpha, fields[i].nSegments);
+    }  // next i
+    double t_loop = _seconds(start);
+
+    // the batch, with the results streamed out as they finish
+    std::vector<std::vector<double>> g_batch(nFields);
+    int nFinished = 0;
+    start = std::chrono::steady_clock::now();
+    gt::gfunction::uniform_borehole_wall_temperature(fields, [&](int i, std::vector<double> &gFunction) {
+        g_batch[i] = gFunction;
+        nFinished++;
+    });
+    double t_batch = _seconds(start);
+
+    if (nFinished != nFields) {
+        throw std::invalid_argument("The batch did not return every g-function.");
+    }
+    // the fields of the batch share an FLS kernel cache, whose keys are quantized to a relative 1e-9
+    double max_difference = 0.;
+    for (int i=0; i<nFields; i++) {
+        if (g_batch[i].size() != g_loop[i].size()) {
+            throw std::invalid_argument("The batch g-function does not have every time value.");
+        }
+        for (int k=0; k<g_loop[i].size(); k++) {
+            max_difference = std::max(max_difference, std::abs(g_batch[i][k] - g_loop[i][k]));
+        }
+    }  // next i
+    std::cout << "Maximum difference between the batch and the loop: " << max_difference << std::endl;
+    if (max_difference > 1.0e-6) {
+        throw std::invalid_argument("The batch g-functions do not match the g-functions computed one at a time.");
+    }
+
+    std::cout << nFields << " configurations" << std::endl;
+    std::cout << "\tloop: " << t_loop << " s, " << nFields / t_loop * 3600. << " configurations per hour"
+              << std::endl;
+    std::cout << "\tbatch: " << t_batch << " s, " << nFields / t_batch * 3600. << " configurations per hour"
+              << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,181 @@
+// Reports the time of the opt-in solver and temporal superposition paths against the path they replace on fields
+// large enough to show the difference, with the largest difference of their results. It takes minutes, which is why
+// it is only built with CPGFUNCTION_BUILD_BENCHMARKS and is not a test (see CMakeLists.txt); the correctness of each
+// path is tested on small fields by its own test.
+
+#include <cpgfunction/coordinates.h>
+#include <cpgfunction/boreholes.h>
+#include <cpgfunction/utilities.h>
+#include <cpgfunction/gfunction.h>
+#include <cpgfunction/heat_transfer.h>
+#include <cpgfunction/options.h>
+#include <cpgfunction/response_store.h>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <tuple>
+
+
+namespace {
+
+    // -- Borehole geometry --
+    const double H = 100.;  // height of the borehole (in meters)
+    const double D = 4.;  // burial depth (in meters)
+    const double r_b = 0.075;  // borehole radius (in meters)
+    const double alpha = 1.0e-06;  // ground thermal diffusivity
+
+    // The options every path is compared with, the batched and vectorized FLS integration
+    gt::options::Options _reference_options() {
+        gt::options::Options options;
+        options.fls_time_batch = true;
+        options.fls_vectorize = true;
+        return options;
+    }  // _reference_options();
+
+    // The boreholes of a field of Nx by Ny boreholes spaced by B
+    std::vector<gt::boreholes::Borehole> _field(const std::string &shape, int Nx, int Ny, double B=5.) {
+        std::vector<std::tuple<double, double>> coordinates = gt::coordinates::configuration(shape, Nx, Ny, B, B);
+        return gt::boreholes::boreField(coordinates, r_b, H, D);
+    }  // _field();
+
+    // The seconds elapsed since start
+    double _seconds(std::chrono::steady_clock::time_point start) {
+        auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1.0e6;
+    }  // _seconds();
+
+    // The g-function of the reference options and of the options modified by path, timed
+    void _compare(const std::string &name, std::vector<gt::boreholes::Borehole> &boreField,
+                  std::vector<double> &time, int nSegments,
+                  const std::function<void(gt::options::Options &)> &path) {
+        gt::options::Options options = _reference_options();
+        auto start = std::chrono::steady_clock::now();
+        std::vector<double> reference = gt::gfunction::uniform_borehole_wall_temperature(
+                boreField, time, alpha, nSegments, true, true, 0, true, false, options);
+        double seconds_reference = _seconds(start);
+        path(options);
+        start = std::chrono::steady_clock::now();
+        std::vector<double> g = gt::gfunction::uniform_borehole_wall_temperature(
+                boreField, time, alpha, nSegments, true, true, 0, true, false, options);
+        double seconds = _seconds(start);
+        double g_error = 0;
+        for (int k=0; k<time.size(); k++) {
+            g_error = std::max(g_error, std::abs(g[k] - reference[k]) / reference[k]);
+        }
+        std::cout << name << ", " << boreField.size() << " boreholes of " << nSegments << " segments, "
+                  << time.size() << " times: " << seconds_reference << " s, " << seconds
+                  << " s, maximum relative difference: " << g_error << std::endl;
+    }  // _compare();
+
+}  // namespace
+
+
+int main() {
+    double ts = H * H / (9. * alpha);
+    double month = 730. * 3600.;
+    std::vector<double> time_Eskilson = gt::utilities::time_Eskilson(H, alpha);
+    std::vector<double> time_hourly = gt::utilities::time_geometric(3600., exp(3.) * ts, 150);
+    std::vector<double> time_monthly = gt::utilities::time_geometric(month, 120 * month, 120);
+    std::vector<double> time_cache = gt::utilities::time_geometric(month, 48 * month, 48);
+    std::vector<gt::boreholes::Borehole> rectangle = _field("Rectangle", 8, 8);
+
+    // ------ Load aggregation (Options::superposition_tol) -------
+    for (double tol : {1.0e-4, 1.0e-3, 1.0e-2}) {
+        _compare("superposition_tol " + std::to_string(tol), rectangle, time_hourly, 8,
+                 [tol](gt::options::Options &options) { options.superposition_tol = tol; });
+    }
+
+    // ------ Blocked superposition (Options::superposition_block) -------
+    for (int block : {8, 16}) {
+        _compare("superposition_block " + std::to_string(block), rectangle, time_monthly, 8,
+                 [block](gt::options::Options &options) { options.superposition_block = block; });
+    }
+
+    // ------ Iterative solver (Options::iterative_solver) -------
+    std::vector<gt::boreholes::Borehole> u = _field("U", 10, 10);
+    _compare("GMRES", u, time_Eskilson, 12,
+             [](gt::options::Options &options) { options.iterative_solver = true; });
+
+    // ------ Packed solver (Options::packed_solver) -------
+    std::vector<gt::boreholes::Borehole> rectangle_10 = _field("Rectangle", 10, 10);
+    for (int reduce=0; reduce<2; reduce++) {
+        auto _packed = [reduce](gt::options::Options &options) {
+            options.symmetry_reduction = reduce == 1;
+            options.packed_solver = true;
+        };
+        _compare(reduce == 1 ? "LDL^T (symmetry reduction)" : "LDL^T", rectangle_10, time_Eskilson, 12, _packed);
+    }  // next reduce
+    int nSources = 12 * int(rectangle_10.size());
+    std::cout << "memory of the system without symmetry reduction, LU: "
+              << double(nSources + 1) * (nSources + 1) * sizeof(double) / 1.0e6 << " MB, LDL^T: "
+              << double(nSources) * (nSources + 1) / 2 * sizeof(double) / 1.0e6 << " MB" << std::endl;
+
+    // ------ Factorization cache (Options::factorization_cache) -------
+    // the response factors are computed once into a response factor store and read back by both, so that only the
+    // time steps are timed
+    std::vector<gt::boreholes::Borehole> rectangle_6 = _field("Rectangle", 8, 8, 6.);
+    std::vector<double> time_first(time_cache.begin(), time_cache.begin() + 1);
+    std::vector<double> time_rest(time_cache.begin() + 1, time_cache.end());
+    for (int cached=-1; cached<2; cached++) {
+        gt::options::Options options = _reference_options();
+        options.factorization_cache = cached == 1 ? 4 : 0;
+        options.response_store = "benchmark_store";
+        gt::gfunction::UniformBoreholeWallTemperature ubhwt(rectangle_6, alpha, 12, true, 0, true, false, options);
+        ubhwt.extend(time_first);
+        auto start = std::chrono::steady_clock::now();
+        ubhwt.extend(time_rest);
+        if (cached >= 0) {
+            std::cout << "factorization_cache " << options.factorization_cache << ", " << time_rest.size()
+                      << " time steps: " << _seconds(start) << " s" << std::endl;
+        }
+    }  // next cached
+    std::vector<gt::boreholes::Borehole> boreSegments_6(12 * rectangle_6.size());
+    gt::gfunction::_borehole_segments(boreSegments_6, rectangle_6, 12);
+    gt::heat_transfer::ResponseFactorStore store("benchmark_store");
+    gt::heat_transfer::ResponseSettings settings(_reference_options(), true, 1);
+    for (std::vector<double> *t : {&time_first, &time_rest}) {
+        std::string path = store.path(gt::heat_transfer::ResponseFactorStore::key(boreSegments_6, *t, alpha, 12,
+                                                                                   settings));
+        std::remove(path.c_str());
+    }
+
+    // ------ Stored differences of the time slices (SegmentResponse::difference_slices) -------
+    int nSegments = 8;
+    nSources = nSegments * int(rectangle.size());
+    int nSum = nSources * (nSources + 1) / 2;
+    std::vector<gt::boreholes::Borehole> boreSegments(nSources);
+    gt::gfunction::_borehole_segments(boreSegments, rectangle, nSegments);
+    for (int Nt : {27, 60, 120}) {
+        std::vector<double> time = Nt == 27 ? time_Eskilson : gt::utilities::time_geometric(3600., exp(3.) * ts, Nt);
+        int nt = time.size();
+        gt::heat_transfer::SegmentResponse SegRes(nSources, nSum, nt);
+        gt::heat_transfer::thermal_response_factors(SegRes, boreSegments, time, alpha, true, false,
+                                                    _reference_options());
+        std::mt19937 generator(11);
+        std::uniform_real_distribution<double> distribution(0., 1.);
+        std::vector<double> q_r(nSources * nt);
+        for (auto &q : q_r) {
+            q = distribution(generator);
+        }
+        double seconds[2];
+        for (int stored=0; stored<2; stored++) {
+            auto start = std::chrono::steady_clock::now();
+            if (stored == 1) {
+                SegRes.difference_slices();
+            }
+            for (int p=0; p<nt; p++) {
+                std::vector<double> Tb_0(nSources);
+                gt::gfunction::_temporal_superposition(Tb_0, SegRes, q_r, p, nSources);
+            }  // next p
+            seconds[stored] = _seconds(start);
+        }  // next stored
+        std::cout << "nt = " << nt << ", " << nSources << " segments, differences formed: " << seconds[0]
+                  << " s, stored (" << double(nSum) * nt * sizeof(double) / 1.0e6 << " MB): " << seconds[1]
+                  << " s" << std::endl;
+    }  // next Nt
+
+    return 0;
+}
@@ -0,0 +1,58 @@
+// Verifies that the g-function on uniform time steps with the known loads of blocks of steps superposed together
+// (Options::superposition_block) is the g-function of the temporal superposition of each step on its own, also on
+// hourly steps whose pruned time slices (Options::fls_prune_tol) are mostly 0.
+
+#include <cpgfunction/coordinates.h>
+#include <cpgfunction/boreholes.h>
+#include <cpgfunction/utilities.h>
+#include <cpgfunction/gfunction.h>
+#include <cpgfunction/options.h>
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+#include <tuple>
+
+
+int main() {
+    // -- Borehole geometry --
+    double H = 100.;  // height of the borehole (in meters)
+    double D = 4.;  // burial depth (in meters)
+    double r_b = 0.075;  // borehole radius (in meters)
+    double alpha = 1.0e-06;  // ground thermal diffusivity
+    int nSegments = 4;
+
+    std::vector<std::tuple<double, double>> coordinates = gt::coordinates::configuration("Rectangle", 3, 3, 5., 5.);
+    std::vector<gt::boreholes::Borehole> boreField = gt::boreholes::boreField(coordinates, r_b, H, D);
+
+    for (int pruned=0; pruned<2; pruned++) {
+        // monthly time steps over 3 years, or hourly time steps over 2 days with the distant pairs pruned
+        double dt = pruned == 1 ? 3600. : 730. * 3600.;
+        int Nt = pruned == 1 ? 48 : 36;
+        std::vector<double> time = gt::utilities::time_geometric(dt, Nt * dt, Nt);
+        int nt = time.size();
+
+        gt::options::Options options;
+        options.fls_time_batch = true;
+        options.fls_vectorize = true;
+        options.fls_prune_tol = pruned == 1 ? 1.0e-10 : 0.;
+        std::vector<double> gFunction = gt::gfunction::uniform_borehole_wall_temperature(
+                boreField, time, alpha, nSegments, true, true, 0, true, false, options);
+        for (int block : {5, 8}) {
+            options.superposition_block = block;
+            std::vector<double> gFunctionBlocked = gt::gfunction::uniform_borehole_wall_temperature(
+                    boreField, time, alpha, nSegments, true, true, 0, true, false, options);
+
+            double g_error = 0;
+            for (int k=0; k<nt; k++) {
+                g_error = std::max(g_error, std::abs(gFunctionBlocked[k] - gFunction[k]) / gFunction[k]);
+            }
+            std::cout << (pruned == 1 ? "pruned, " : "") << "superposition_block " << block
+                      << ", maximum relative difference: " << g_error << std::endl;
+            if (g_error > 1.0e-10) {
+                throw std::invalid_argument("The g-function of the blocked superposition differs.");
+            }
+        }  // next block
+    }  // next pruned
+
+    return 0;
+}
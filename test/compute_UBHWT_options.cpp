@@ -0,0 +1,115 @@
+// Computes the validation g-functions with each of the opt-in computational paths (gt::options::Options) and
+// verifies them against the reference curves within the tolerance of that path
+
+#include <cpgfunction/coordinates.h>
+#include <cpgfunction/boreholes.h>
+#include <cpgfunction/utilities.h>
+#include <cpgfunction/gfunction.h>
+#include <cpgfunction/kernel_cache.h>
+#include <cpgfunction/options.h>
+#include <cpgfunction/statistics.h>
+#include <nlohmann/json.hpp>
+#include <fstream>
+#include <tuple>
+#include <stdexcept>
+
+
+std::vector<double> import_gFunction(std::string input_path) {
+    // nlohmann json input
+    std::ifstream in(input_path);
+    nlohmann::json js;
+    in >> js;
+
+    std::vector<double> y = js["g"];
+
+    return y;
+}
+
+
+int main(){
+    // -- Definitions --
+    // Coordinate geometry
+    int Nx = 10;
+    int Ny = 10;
+    double Bx = 6.;
+    double By = 4.5;
+
+    // -- Borehole geometry --
+    double H = 100;  // height of the borehole (in meters)
+    double D = 4;  // burial depth (in meters)
+    double r_b = 0.075;  // borehole radius (in meters)
+
+    // Ground properties
+    double alpha = 1.0e-06;  // ground thermal diffusivity
+
+    // -- Time definition --
+    // Eskilson's original 27 time steps (in seconds)
+    std::vector<double> time = gt::utilities::time_Eskilson(H, alpha);
+
+    // -- Computational paths --
+    // name, options and the root mean square error (%) allowed against the reference curve
+    std::vector<std::tuple<std::string, gt::options::Options, double>> paths;
+    gt::options::Options options;
+    paths.emplace_back("default", options, 1.0E-12);
+
+    options = gt::options::Options();
+    options.fls_time_batch = true;
+    paths.emplace_back("fls_time_batch", options, 1.0E-8);
+
+    options = gt::options::Options();
+    options.fls_vectorize = true;
+    paths.emplace_back("fls_vectorize", options, 1.0E-8);
+
+    options.fls_time_batch = true;
+    paths.emplace_back("fls_time_batch + fls_vectorize", options, 1.0E-8);
+
+    options.fls_cache = &gt::heat_transfer::FLSKernelCache::instance();
+    paths.emplace_back("fls_time_batch + fls_vectorize + fls_cache", options, 1.0E-8);
+
+    options = gt::options::Options();
+    options.storage_mode = 0;
+    paths.emplace_back("storage_mode 0", options, 1.0E-12);
+
+    // the pruning tolerance bounds the error of each response factor, the g-functions are reported for a tight and
+    // a loose one
+    options = gt::options::Options();
+    options.fls_time_batch = true;
+    options.fls_vectorize = true;
+    options.fls_prune_tol = 1.0E-10;
+    paths.emplace_back("fls_time_batch + fls_vectorize + fls_prune_tol 1e-10", options, 1.0E-8);
+    options.fls_prune_tol = 1.0E-4;
+    paths.emplace_back("fls_time_batch + fls_vectorize + fls_prune_tol 1e-4", options, 1.0E-2);
+
+    // -- Configurations --
+    std::vector<std::string> shapes{"OpenRectangle", "U", "L"};
+
+    for (auto &path : paths) {
+        std::cout << "Computational path: " << std::get<0>(path) << std::endl;
+        double total_time = 0;
+        for (auto &shape : shapes) {
+            std::vector<std::tuple<double, double>> coordinates =
+                    gt::coordinates::configuration(shape, Nx, Ny, Bx, By);
+            std::vector<gt::boreholes::Borehole> boreField = gt::boreholes::boreField(coordinates, r_b, H, D);
+
+            auto start = std::chrono::steady_clock::now();
+            vector<double> gFunction = gt::gfunction::uniform_borehole_wall_temperature(
+                    boreField, time, alpha, 12, true, true, 1, true, false, std::get<1>(path));
+            auto end = std::chrono::steady_clock::now();
+            auto milli = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+            total_time += double(milli) / 1000;
+
+            std::vector<double> gFunctionReference = import_gFunction(shape + ".json");
+            double rmse = gt::statistics::root_mean_square_error(gFunctionReference, gFunction);
+            rmse *= 100;
+
+            std::cout << "\t" << shape << " rmse (%): " << rmse << std::endl;
+            if (rmse > std::get<2>(path)) {
+                throw std::invalid_argument("The root mean square error of the " + std::get<0>(path) +
+                                            " path is more than its tolerance.");
+            }
+        }
+        std::cout << "\ttime: " << total_time << " seconds" << std::endl;
+    }
+
+    return 0;
+}
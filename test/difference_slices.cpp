@@ -0,0 +1,70 @@
+// Verifies that the temporal superposition of every time step with the differences of the time slices stored once
+// (SegmentResponse::difference_slices) gives the borehole wall temperatures of the differences formed at each step.
+
+#include <cpgfunction/coordinates.h>
+#include <cpgfunction/boreholes.h>
+#include <cpgfunction/utilities.h>
+#include <cpgfunction/gfunction.h>
+#include <cpgfunction/heat_transfer.h>
+#include <cpgfunction/options.h>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <tuple>
+
+
+int main() {
+    // -- Borehole geometry --
+    double H = 100.;  // height of the borehole (in meters)
+    double D = 4.;  // burial depth (in meters)
+    double r_b = 0.075;  // borehole radius (in meters)
+    double alpha = 1.0e-06;  // ground thermal diffusivity
+    int nSegments = 4;
+
+    std::vector<std::tuple<double, double>> coordinates = gt::coordinates::configuration("Rectangle", 3, 3, 5., 5.);
+    std::vector<gt::boreholes::Borehole> boreField = gt::boreholes::boreField(coordinates, r_b, H, D);
+    int nSources = nSegments * boreField.size();
+    int nSum = nSources * (nSources + 1) / 2;
+    std::vector<gt::boreholes::Borehole> boreSegments(nSources);
+    gt::gfunction::_borehole_segments(boreSegments, boreField, nSegments);
+
+    std::vector<double> time = gt::utilities::time_Eskilson(H, alpha);
+    int nt = time.size();
+    gt::options::Options options;
+    options.fls_time_batch = true;
+    options.fls_vectorize = true;
+    gt::heat_transfer::SegmentResponse SegRes(nSources, nSum, nt);
+    gt::heat_transfer::thermal_response_factors(SegRes, boreSegments, time, alpha, true, false, options);
+
+    // a load history of every time step
+    std::mt19937 generator(11);
+    std::uniform_real_distribution<double> distribution(0., 1.);
+    std::vector<double> q_r(nSources * nt);
+    for (auto &q : q_r) {
+        q = distribution(generator);
+    }
+
+    std::vector<double> Tb[2];
+    for (int stored=0; stored<2; stored++) {
+        if (stored == 1) {
+            SegRes.difference_slices();
+        }
+        for (int p=0; p<nt; p++) {
+            std::vector<double> Tb_0(nSources);
+            gt::gfunction::_temporal_superposition(Tb_0, SegRes, q_r, p, nSources);
+            Tb[stored].insert(Tb[stored].end(), Tb_0.begin(), Tb_0.end());
+        }  // next p
+    }  // next stored
+
+    double Tb_error = 0;
+    for (int n=0; n<Tb[0].size(); n++) {
+        Tb_error = std::max(Tb_error, std::abs(Tb[1][n] - Tb[0][n]));
+    }
+    std::cout << "stored differences of " << nt << " time slices, maximum difference: " << Tb_error << std::endl;
+    if (Tb_error > 1.0e-12) {
+        throw std::invalid_argument("The superposition of the stored differences differs.");
+    }
+
+    return 0;
+}
@@ -0,0 +1,109 @@
+// Groups the segment pairs of irregular fields by distance. The groups are compared with those of the linear scan
+// over the groups (the previous implementation) and the time of the grouping is reported for fields of up to
+// max_boreholes boreholes (first argument, 256 by default) of 24 segments, together with the time divided by
+// P log P (P the number of segment pairs), which stays flat when the grouping scales as O(n^2 log n).
+
+#include <cpgfunction/boreholes.h>
+#include <cpgfunction/gfunction.h>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+
+// The linear scan over the groups found so far
+void linear_scan(std::vector<gt::boreholes::Borehole> &boreSegments,
+                 std::vector<std::vector<std::tuple<int, int>>> &Pairs, std::vector<double> &disPairs,
+                 double disTol) {
+    Pairs.assign(1, std::vector<std::tuple<int, int>>(1, std::tuple<int, int>(0, 0)));
+    disPairs.assign(1, boreSegments[0].r_b);
+    int nb = boreSegments.size();
+    for (int i=0; i<nb; i++) {
+        for (int j=std::max(i, 1); j<nb; j++) {
+            double dis = boreSegments[i].distance(boreSegments[j]);
+            double rTol = i == j ? 1.0e-6 * boreSegments[i].r_b : disTol;
+            int nDis = disPairs.size();
+            for (int k=0; k<nDis; k++) {
+                if (std::abs(disPairs[k] - dis) < rTol) {
+                    Pairs[k].push_back(std::tuple<int, int>(i, j));
+                    break;
+                }
+                if (k == nDis - 1) {
+                    disPairs.push_back(dis);
+                    Pairs.push_back(std::vector<std::tuple<int, int>>(1, std::tuple<int, int>(i, j)));
+                }
+            }  // next k
+        }  // next j
+    }  // next i
+}
+
+// A field of nBoreholes boreholes placed at random (about 6 m apart on average)
+std::vector<gt::boreholes::Borehole> random_field(const int nBoreholes, const int nSegments) {
+    std::mt19937 generator(101);
+    double L = 6. * std::sqrt(double(nBoreholes));
+    std::uniform_real_distribution<double> position(0., L);
+    std::vector<gt::boreholes::Borehole> boreField;
+    for (int b=0; b<nBoreholes; b++) {
+        boreField.emplace_back(100., 4., 0.075, position(generator), position(generator));
+    }
+    std::vector<gt::boreholes::Borehole> boreSegments(nBoreholes * nSegments);
+    gt::gfunction::_borehole_segments(boreSegments, boreField, nSegments);
+    return boreSegments;
+}
+
+int main(int argc, char *argv[]) {
+    int max_boreholes = argc > 1 ? std::atoi(argv[1]) : 256;
+    int nSegments = 24;
+    double disTol = 0.1;
+
+    auto _seconds = [](std::chrono::steady_clock::time_point start) {
+        auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1.0e6;
+    };
+
+    // -- Same groups as the linear scan --
+    {
+        std::vector<gt::boreholes::Borehole> boreSegments = random_field(40, nSegments);
+        std::vector<std::vector<std::tuple<int, int>>> Pairs_reference;
+        std::vector<double> disPairs_reference;
+        auto start = std::chrono::steady_clock::now();
+        linear_scan(boreSegments, Pairs_reference, disPairs_reference, disTol);
+        double t_reference = _seconds(start);
+
+        gt::boreholes::Similarity sim;
+        std::vector<std::vector<std::tuple<int, int>>> Pairs;
+        std::vector<int> nPairs;
+        std::vector<double> disPairs;
+        int nDis;
+        start = std::chrono::steady_clock::now();
+        sim._similarities_group_by_distance(boreSegments, Pairs, nPairs, disPairs, nDis, disTol);
+        double t_grouping = _seconds(start);
+        if (Pairs != Pairs_reference || disPairs != disPairs_reference || nDis != int(disPairs.size())) {
+            throw std::invalid_argument("The distance groups are not those of the linear scan.");
+        }
+        for (int k=0; k<nDis; k++) {
+            if (nPairs[k] != int(Pairs[k].size())) {
+                throw std::invalid_argument("The number of pairs of a distance group is wrong.");
+            }
+        }  // next k
+        std::cout << boreSegments.size() << " segments, " << nDis << " distances; linear scan: " << t_reference
+                  << " s, grouping: " << t_grouping << " s" << std::endl;
+    }
+
+    // -- Scaling --
+    for (int nBoreholes=32; nBoreholes<=max_boreholes; nBoreholes*=2) {
+        std::vector<gt::boreholes::Borehole> boreSegments = random_field(nBoreholes, nSegments);
+        double P = 0.5 * double(boreSegments.size()) * double(boreSegments.size() + 1);
+        gt::boreholes::Similarity sim;
+        std::vector<std::vector<std::tuple<int, int>>> Pairs;
+        std::vector<int> nPairs;
+        std::vector<double> disPairs;
+        int nDis;
+        auto start = std::chrono::steady_clock::now();
+        sim._similarities_group_by_distance(boreSegments, Pairs, nPairs, disPairs, nDis, disTol);
+        double t_grouping = _seconds(start);
+        std::cout << nBoreholes << " x " << nSegments << " segments, " << nDis << " distances: " << t_grouping
+                  << " s, " << t_grouping / (P * std::log2(P)) * 1.0e9 << " ns / (P log P)" << std::endl;
+    }  // next nBoreholes
+
+    return 0;
+}
@@ -0,0 +1,76 @@
+// Verifies that a task group never runs more tasks at once than it is allowed to, that nested groups do not
+// deadlock and that an exception thrown by a task reaches the thread waiting on the group
+
+#include <cpgfunction/executor.h>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+
+
+int main() {
+    gt::parallel::Executor executor(6);
+
+    // -- Bounded concurrency --
+    for (int nThreads : {1, 3, 7}) {
+        std::atomic<int> running(0);
+        std::atomic<int> most(0);
+        std::atomic<int> done(0);
+        gt::parallel::TaskGroup group(executor, nThreads);
+        for (int i=0; i<200; i++) {
+            group.run([&running, &most, &done] {
+                int now = ++running;
+                int seen = most;
+                while (now > seen && !most.compare_exchange_weak(seen, now)) {
+                }
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+                running--;
+                done++;
+            });
+        }
+        group.wait();
+        std::cout << "nThreads: " << nThreads << ", tasks run: " << done << ", most at once: " << most
+                  << std::endl;
+        if (done != 200 || most > nThreads) {
+            throw std::invalid_argument("The task group did not respect its number of threads.");
+        }
+    }
+
+    // -- Nested groups --
+    std::atomic<int> count(0);
+    gt::parallel::TaskGroup outer(executor);
+    for (int i=0; i<16; i++) {
+        outer.run([&executor, &count] {
+            gt::parallel::TaskGroup inner(executor);
+            for (int j=0; j<16; j++) {
+                inner.run([&count] { count++; });
+            }
+            inner.wait();
+        });
+    }
+    outer.wait();
+    if (count != 256) {
+        throw std::invalid_argument("The nested task groups did not run every task.");
+    }
+
+    // -- Exceptions --
+    gt::parallel::TaskGroup group(executor);
+    for (int i=0; i<8; i++) {
+        group.run([i] {
+            if (i == 5) {
+                throw std::runtime_error("task 5");
+            }
+        });
+    }
+    bool caught = false;
+    try {
+        group.wait();
+    } catch (std::runtime_error &e) {
+        caught = true;
+    }
+    if (!caught) {
+        throw std::invalid_argument("The exception thrown by a task was not rethrown by wait().");
+    }
+
+    return 0;
+}
@@ -0,0 +1,67 @@
+// Extends a g-function in three parts (as a design horizon grows) and verifies that it is the same as the g-function
+// computed over the whole time vector at once, and reports the time of each extension against recomputing
+
+#include <cpgfunction/coordinates.h>
+#include <cpgfunction/boreholes.h>
+#include <cpgfunction/utilities.h>
+#include <cpgfunction/gfunction.h>
+#include <cpgfunction/options.h>
+#include <chrono>
+#include <stdexcept>
+
+
+int main() {
+    int Nx = 10;
+    int Ny = 10;
+    double Bx = 6.;
+    double By = 4.5;
+    double H = 100.;
+    double D = 4.;
+    double r_b = 0.075;
+    double alpha = 1.0e-06;
+    int nSegments = 12;
+
+    std::vector<std::tuple<double, double>> coordinates = gt::coordinates::configuration("U", Nx, Ny, Bx, By);
+    std::vector<gt::boreholes::Borehole> boreField = gt::boreholes::boreField(coordinates, r_b, H, D);
+    std::vector<double> time = gt::utilities::time_Eskilson(H, alpha);
+    std::vector<int> parts{12, 20, int(time.size())};
+
+    auto _seconds = [](std::chrono::steady_clock::time_point start) {
+        auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1.0e6;
+    };
+
+    for (int storage_mode : {1, 0}) {
+        gt::options::Options options;
+        options.storage_mode = storage_mode;
+        std::cout << "storage_mode " << storage_mode << std::endl;
+
+        gt::gfunction::UniformBoreholeWallTemperature extended(boreField, alpha, nSegments, true, 0, true, false,
+                                                               options);
+        int nt = 0;
+        for (int part : parts) {
+            std::vector<double> time_part(time.begin(), time.begin() + part);
+            std::vector<double> time_new(time.begin() + nt, time.begin() + part);
+            auto start = std::chrono::steady_clock::now();
+            std::vector<double> g_full = gt::gfunction::uniform_borehole_wall_temperature(
+                    boreField, time_part, alpha, nSegments, true, true, 0, true, false, options);
+            double t_full = _seconds(start);
+            start = std::chrono::steady_clock::now();
+            std::vector<double> &g_extended = extended.extend(time_new);
+            double t_extended = _seconds(start);
+            std::cout << "\t" << nt << " -> " << part << " time values, recomputed: " << t_full
+                      << " s, extended: " << t_extended << " s" << std::endl;
+            if (g_extended.size() != g_full.size()) {
+                throw std::invalid_argument("The extended g-function does not have every time value.");
+            }
+            for (int k=0; k<part; k++) {
+                if (g_extended[k] != g_full[k]) {
+                    throw std::invalid_argument("The extended g-function differs from the one computed at once.");
+                }
+            }  // next k
+            nt = part;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,76 @@
+// Verifies that the g-function on a uniform time vector, where every time step is the same, solved with the cached
+// LU factorizations of the system of equations (Options::factorization_cache) is the g-function refactorized at each
+// step, for the dense and the packed solvers, and that a singular system (two boreholes at the same position) throws
+// rather than being cached.
+
+#include <cpgfunction/coordinates.h>
+#include <cpgfunction/boreholes.h>
+#include <cpgfunction/utilities.h>
+#include <cpgfunction/gfunction.h>
+#include <cpgfunction/options.h>
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+#include <tuple>
+
+
+int main() {
+    // -- Borehole geometry --
+    double H = 100.;  // height of the borehole (in meters)
+    double D = 4.;  // burial depth (in meters)
+    double r_b = 0.075;  // borehole radius (in meters)
+    double alpha = 1.0e-06;  // ground thermal diffusivity
+    int nSegments = 4;
+
+    std::vector<std::tuple<double, double>> coordinates = gt::coordinates::configuration("Rectangle", 3, 3, 5., 5.);
+    std::vector<gt::boreholes::Borehole> boreField = gt::boreholes::boreField(coordinates, r_b, H, D);
+
+    // monthly time steps over 2 years
+    double dt = 730. * 3600.;
+    int Nt = 24;
+    std::vector<double> time = gt::utilities::time_geometric(dt, Nt * dt, Nt);
+    int nt = time.size();
+
+    for (int packed=0; packed<2; packed++) {
+        gt::options::Options options;
+        options.fls_time_batch = true;
+        options.fls_vectorize = true;
+        options.packed_solver = packed == 1;
+        std::vector<double> gFunction = gt::gfunction::uniform_borehole_wall_temperature(
+                boreField, time, alpha, nSegments, true, true, 0, true, false, options);
+        options.factorization_cache = 4;
+        std::vector<double> gFunctionCached = gt::gfunction::uniform_borehole_wall_temperature(
+                boreField, time, alpha, nSegments, true, true, 0, true, false, options);
+
+        double g_error = 0;
+        for (int k=0; k<nt; k++) {
+            g_error = std::max(g_error, std::abs(gFunctionCached[k] - gFunction[k]));
+        }
+        std::cout << (packed == 1 ? "cached LDL^T factorizations" : "cached LU factorizations")
+                  << ", maximum difference: " << g_error << std::endl;
+        if (g_error > 1.0e-10) {
+            throw std::invalid_argument("The g-function of the cached factorizations differs.");
+        }
+    }  // next packed
+
+    // two boreholes at the same position, their columns of the system of equations are the same
+    std::vector<std::tuple<double, double>> coincident{std::make_tuple(0., 0.), std::make_tuple(0., 0.)};
+    std::vector<gt::boreholes::Borehole> coincidentField = gt::boreholes::boreField(coincident, r_b, H, D);
+    for (int packed=0; packed<2; packed++) {
+        gt::options::Options options;
+        options.packed_solver = packed == 1;
+        options.factorization_cache = 4;
+        bool singular = false;
+        try {
+            gt::gfunction::uniform_borehole_wall_temperature(coincidentField, time, alpha, 1, true, true, 0, true,
+                                                             false, options);
+        } catch (std::runtime_error &e) {
+            singular = true;
+        }
+        if (!singular) {
+            throw std::invalid_argument("The factorization of a singular system of equations is used.");
+        }
+    }  // next packed
+
+    return 0;
+}
@@ -0,0 +1,115 @@
+// Compares the vectorized FLS integrand against the scalar one and reports the speedup of each FLS path
+
+#include <cpgfunction/fls_integrand.h>
+#include <cpgfunction/heat_transfer.h>
+#include <cpgfunction/utilities.h>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+
+
+int main() {
+    double H = 100.;
+    double D = 4.;
+    double r_b = 0.075;
+    double alpha = 1.0e-06;
+    int nSegments = 12;
+    double H_s = H / double(nSegments);
+    std::vector<double> time = gt::utilities::time_Eskilson(H, alpha);
+
+    std::cout << "Vectorized FLS integrand instruction set: " << gt::heat_transfer::fls_integrand_isa() << std::endl;
+
+    // pairs of segments at the distances found in a 10x10 field
+    std::vector<gt::boreholes::Borehole> b1s;
+    std::vector<gt::boreholes::Borehole> b2s;
+    std::vector<double> distances{0., 4.5, 6., 7.5, 13.5, 30., 60.};
+    for (double dis : distances) {
+        for (int j=0; j<nSegments; j+=3) {
+            b1s.emplace_back(H_s, D, r_b, 0., 0.);
+            b2s.emplace_back(H_s, D + double(j) * H_s, r_b, dis, 0.);
+        }
+    }
+
+    // -- Accuracy of the integrand --
+    int n = 2000;
+    std::vector<double> s(n);
+    std::vector<double> f_scalar(n);
+    std::vector<double> f_vector(n);
+    for (int i=0; i<n; i++) {
+        s[i] = 1.0e-4 * std::pow(1.0e5, double(i) / double(n));  // covers the lower bounds of all times
+    }
+    // The erfint terms cancel each other at large s, so both integrands are compared to an extended precision one
+    double error_scalar = 0;
+    double error_vector = 0;
+    for (int p=0; p<b1s.size(); p++) {
+        for (int kind=0; kind<2; kind++) {
+            gt::heat_transfer::FLSIntegrand integrand(b1s[p], b2s[p], kind == 0, kind == 1);
+            integrand.evaluate_scalar(&*s.begin(), &*f_scalar.begin(), n);
+            integrand.evaluate(&*s.begin(), &*f_vector.begin(), n);
+            double scale = 0;
+            for (int i=0; i<n; i++) {
+                scale = std::max(scale, std::abs(f_scalar[i]));
+            }
+            for (int i=0; i<n; i++) {
+                long double x = s[i];
+                long double func = 0;
+                for (int m=0; m<integrand.nTerms; m++) {
+                    long double y = (long double)(integrand.d[m]) * x;
+                    func += integrand.sign[m] * (y * erfl(y) - (1 - expl(-y * y)) / sqrtl(M_PI));
+                }
+                long double r = integrand.r;
+                long double f = 0.5L / (integrand.H2 * x * x) * func * expl(-r * r * x * x);
+                error_scalar = std::max(error_scalar, double(fabsl(f_scalar[i] - f)) / scale);
+                error_vector = std::max(error_vector, double(fabsl(f_vector[i] - f)) / scale);
+            }
+        }
+    }
+    std::cout << "Maximum error of the integrand (relative to its maximum), scalar: " << error_scalar
+              << ", vectorized: " << error_vector << std::endl;
+    if (error_vector > 1.1 * error_scalar) {
+        throw std::invalid_argument("The vectorized FLS integrand is not as accurate as the scalar one.");
+    }
+
+    // -- Timings of the FLS solution --
+    auto _time_path = [&](const bool time_batch, const bool vectorize, std::vector<std::vector<double>> &h) {
+        auto start = std::chrono::steady_clock::now();
+        h.resize(b1s.size());
+        for (int p=0; p<b1s.size(); p++) {
+            if (time_batch) {
+                gt::heat_transfer::finite_line_source(h[p], time, alpha, b1s[p], b2s[p], true, true, vectorize);
+            } else {
+                h[p].resize(time.size());
+                for (int k=0; k<time.size(); k++) {
+                    h[p][k] = gt::heat_transfer::finite_line_source(time[k], alpha, b1s[p], b2s[p], true, true,
+                                                                    vectorize);
+                }
+            }
+        }
+        auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1.0e6;
+    };
+    std::vector<std::vector<double>> h_reference;
+    std::vector<std::vector<double>> h;
+    double t_reference = _time_path(false, false, h_reference);
+    std::cout << "FLS path\t\t\ttime (s)\tspeedup\tmax error" << std::endl;
+    std::cout << "scalar\t\t\t\t" << t_reference << "\t1" << std::endl;
+    std::vector<std::tuple<std::string, bool, bool>> paths{
+        std::make_tuple("vectorize\t\t", false, true),
+        std::make_tuple("time batch\t\t", true, false),
+        std::make_tuple("time batch + vectorize", true, true)};
+    for (auto &path : paths) {
+        double t = _time_path(std::get<1>(path), std::get<2>(path), h);
+        double error = 0;
+        for (int p=0; p<h.size(); p++) {
+            for (int k=0; k<time.size(); k++) {
+                error = std::max(error, std::abs(h[p][k] - h_reference[p][k]) / std::abs(h_reference[p].back()));
+            }
+        }
+        std::cout << std::get<0>(path) << "\t" << t << "\t" << t_reference / t << "\t" << error << std::endl;
+        if (error > 1.0e-8) {
+            throw std::invalid_argument("The FLS path is not as accurate as the scalar one.");
+        }
+    }
+
+    return 0;
+}
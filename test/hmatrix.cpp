@@ -0,0 +1,139 @@
+// Compresses the segment to segment response factors of a field into an H-matrix (storage_mode 2), verifies its
+// entries and its products against the packed response factors (storage_mode 1) and compares the memory of both,
+// then verifies the g-function computed from the compressed response factors by the iterative solver, the only one
+// they are applied with.
+
+#include <cpgfunction/coordinates.h>
+#include <cpgfunction/boreholes.h>
+#include <cpgfunction/utilities.h>
+#include <cpgfunction/gfunction.h>
+#include <cpgfunction/heat_transfer.h>
+#include <cpgfunction/hmatrix.h>
+#include <cpgfunction/options.h>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+
+
+int main() {
+    double H = 100.;
+    double D = 4.;
+    double r_b = 0.075;
+    double alpha = 1.0e-06;
+    double tol = 1.0e-6;
+    std::vector<double> time = gt::utilities::time_Eskilson(H, alpha);
+    int nt = time.size();
+
+    // -- Response factors --
+    int nSegments = 8;
+    std::vector<std::tuple<double, double>> coordinates = gt::coordinates::configuration("Rectangle", 12, 12, 5., 5.);
+    std::vector<gt::boreholes::Borehole> boreField = gt::boreholes::boreField(coordinates, r_b, H, D);
+    int nSources = nSegments * boreField.size();
+    int nSum = nSources * (nSources + 1) / 2;
+    std::vector<gt::boreholes::Borehole> boreSegments(nSources);
+    gt::gfunction::_borehole_segments(boreSegments, boreField, nSegments);
+
+    gt::options::Options options;
+    options.fls_time_batch = true;
+    options.fls_vectorize = true;
+    gt::heat_transfer::SegmentResponse packed(nSources, nSum, nt);
+    gt::heat_transfer::thermal_response_factors(packed, boreSegments, time, alpha, true, false, options);
+
+    options.similarity_stream = true;
+    options.hmatrix_tol = tol;
+    gt::heat_transfer::SegmentResponse compressed(nSources, nSum, nt, 2);
+    auto start = std::chrono::steady_clock::now();
+    gt::heat_transfer::thermal_response_factors(compressed, boreSegments, time, alpha, true, false, options);
+    auto end = std::chrono::steady_clock::now();
+    gt::heat_transfer::HMatrix &hMatrix = *compressed.hMatrix;
+
+    // the entries and the products of each time, relative to the largest entry and product of that time
+    std::mt19937 generator(7);
+    std::uniform_real_distribution<double> distribution(0., 1.);
+    std::vector<double> x(nSources);
+    for (auto &x_i : x) {
+        x_i = distribution(generator);
+    }
+    double entry_error = 0;
+    double product_error = 0;
+    for (int k=0; k<nt; k++) {
+        double *h = packed.slice(k);
+        double h_max = 0;
+        double difference = 0;
+        int index = 0;
+        for (int i=0; i<nSources; i++) {
+            for (int j=i; j<nSources; j++, index++) {
+                h_max = std::max(h_max, std::abs(h[index]));
+                difference = std::max(difference, std::abs(h[index] - hMatrix.value(i, j, k)));
+            }
+        }  // next i
+        entry_error = std::max(entry_error, difference / h_max);
+
+        std::vector<double> y(nSources, 0.);
+        std::vector<double> y_compressed(nSources, 0.);
+        index = 0;
+        for (int i=0; i<nSources; i++) {
+            for (int j=i; j<nSources; j++, index++) {
+                y[i] += h[index] * x[j];
+                if (i != j) {
+                    y[j] += h[index] * x[i];
+                }
+            }
+        }  // next i
+        hMatrix.multiply(k, 1., x.data(), y_compressed.data());
+        double y_max = 0;
+        difference = 0;
+        for (int i=0; i<nSources; i++) {
+            y_max = std::max(y_max, std::abs(y[i]));
+            difference = std::max(difference, std::abs(y[i] - y_compressed[i]));
+        }
+        product_error = std::max(product_error, difference / y_max);
+    }  // next k
+    double seconds = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() / 1000.;
+    std::cout << nSources << " segments, " << hMatrix.nBlocks() << " blocks (" << hMatrix.nLowRank()
+              << " low rank, mean rank " << hMatrix.meanRank() << ") in " << seconds << " s" << std::endl;
+    std::cout << "storage_mode 1: " << double(nSum) * nt * sizeof(double) / 1.0e6 << " MB, storage_mode 2: "
+              << hMatrix.bytes() / 1.0e6 << " MB" << std::endl;
+    std::cout << "maximum relative difference of the entries: " << entry_error << ", of the products: "
+              << product_error << std::endl;
+    if (entry_error > 100 * tol || product_error > 100 * tol) {
+        throw std::invalid_argument("The H-matrix does not approximate the response factors within its tolerance.");
+    }
+
+    // -- g-function --
+    coordinates = gt::coordinates::configuration("Rectangle", 8, 8, 5., 5.);
+    boreField = gt::boreholes::boreField(coordinates, r_b, H, D);
+    options = gt::options::Options();
+    options.fls_time_batch = true;
+    options.fls_vectorize = true;
+    std::vector<double> gFunction = gt::gfunction::uniform_borehole_wall_temperature(
+            boreField, time, alpha, nSegments, true, true, 0, true, false, options);
+    options.similarity_stream = true;
+    options.storage_mode = 2;
+    options.hmatrix_tol = tol;
+    bool dense = true;
+    try {
+        gt::gfunction::uniform_borehole_wall_temperature(boreField, time, alpha, nSegments, true, true, 0, true,
+                                                         false, options);
+    } catch (std::invalid_argument &e) {
+        dense = false;
+    }
+    if (dense) {
+        throw std::invalid_argument("The compressed response factors are solved for by the dense solver.");
+    }
+    options.iterative_solver = true;
+    std::vector<double> gFunctionCompressed = gt::gfunction::uniform_borehole_wall_temperature(
+            boreField, time, alpha, nSegments, true, true, 0, true, false, options);
+    double g_error = 0;
+    for (int k=0; k<nt; k++) {
+        g_error = std::max(g_error, std::abs(gFunction[k] - gFunctionCompressed[k]));
+    }
+    std::cout << "maximum difference of the g-function of " << boreField.size() << " boreholes: " << g_error
+              << std::endl;
+    if (g_error > 1.0e-4) {
+        throw std::invalid_argument("The g-function of the compressed response factors differs.");
+    }
+
+    return 0;
+}
@@ -0,0 +1,49 @@
+// Verifies that the g-function of a field solved with the iterative solver (GMRES, matrix-free) is the g-function of
+// the dense LU decomposition.
+
+#include <cpgfunction/coordinates.h>
+#include <cpgfunction/boreholes.h>
+#include <cpgfunction/utilities.h>
+#include <cpgfunction/gfunction.h>
+#include <cpgfunction/options.h>
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+#include <tuple>
+
+
+int main() {
+    // -- Borehole geometry --
+    double H = 100.;  // height of the borehole (in meters)
+    double D = 4.;  // burial depth (in meters)
+    double r_b = 0.075;  // borehole radius (in meters)
+    double alpha = 1.0e-06;  // ground thermal diffusivity
+    int nSegments = 6;
+
+    std::vector<double> time = gt::utilities::time_Eskilson(H, alpha);
+    int nt = time.size();
+
+    std::vector<std::tuple<double, double>> coordinates = gt::coordinates::configuration("U", 4, 4, 5., 5.);
+    std::vector<gt::boreholes::Borehole> boreField = gt::boreholes::boreField(coordinates, r_b, H, D);
+
+    gt::options::Options options;
+    options.fls_time_batch = true;
+    options.fls_vectorize = true;
+    std::vector<double> gFunction = gt::gfunction::uniform_borehole_wall_temperature(
+            boreField, time, alpha, nSegments, true, true, 0, true, false, options);
+    options.iterative_solver = true;
+    std::vector<double> gFunctionIterative = gt::gfunction::uniform_borehole_wall_temperature(
+            boreField, time, alpha, nSegments, true, true, 0, true, false, options);
+
+    double g_error = 0;
+    for (int k=0; k<nt; k++) {
+        g_error = std::max(g_error, std::abs(gFunction[k] - gFunctionIterative[k]));
+    }
+    std::cout << boreField.size() << " boreholes of " << nSegments << " segments, GMRES maximum difference: "
+              << g_error << std::endl;
+    if (g_error > 1.0e-8) {
+        throw std::invalid_argument("The g-function of the iterative solver differs.");
+    }
+
+    return 0;
+}
@@ -0,0 +1,86 @@
+// Computes the g-function of a field, then of the same field scaled to a different borehole length and ground
+// diffusivity, and verifies that the second field is found in the FLS kernel cache and gives the same g-function as
+// when it is computed without the cache
+
+#include <cpgfunction/coordinates.h>
+#include <cpgfunction/boreholes.h>
+#include <cpgfunction/utilities.h>
+#include <cpgfunction/gfunction.h>
+#include <cpgfunction/kernel_cache.h>
+#include <cpgfunction/options.h>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+
+
+int main() {
+    int Nx = 10;
+    int Ny = 10;
+    double Bx = 6.;
+    double By = 4.5;
+    double H = 100.;
+    double D = 4.;
+    double r_b = 0.075;
+    double alpha = 1.0e-06;
+    int nSegments = 12;
+
+    gt::heat_transfer::FLSKernelCache cache;
+    gt::options::Options options;
+    options.fls_time_batch = true;
+    options.fls_vectorize = true;
+    options.fls_cache = &cache;
+
+    // every length is multiplied by L and the diffusivity by a, leaving the dimensionless groups unchanged
+    auto _g_function = [&](const double L, const double a, std::vector<double> &gFunction) {
+        std::vector<std::tuple<double, double>> coordinates =
+                gt::coordinates::configuration("U", Nx, Ny, L * Bx, L * By);
+        std::vector<gt::boreholes::Borehole> boreField =
+                gt::boreholes::boreField(coordinates, L * r_b, L * H, L * D);
+        std::vector<double> time = gt::utilities::time_Eskilson(L * H, a * alpha);
+        auto start = std::chrono::steady_clock::now();
+        gFunction = gt::gfunction::uniform_borehole_wall_temperature(boreField, time, a * alpha, nSegments,
+                                                                      true, true, 1, true, false, options);
+        auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1.0e6;
+    };
+
+    std::vector<double> g1;
+    std::vector<double> g2;
+    std::vector<double> g2_reference;
+    options.fls_cache = nullptr;
+    double t_reference = _g_function(1.5, 2.5, g2_reference);
+    std::cout << "Scaled field without the cache: " << t_reference << " s" << std::endl;
+    options.fls_cache = &cache;
+
+    double t1 = _g_function(1., 1., g1);
+    long misses1 = cache.misses();
+    long hits1 = cache.hits();
+    std::cout << "First field: " << t1 << " s, hits: " << hits1 << ", misses: " << misses1
+              << ", values stored: " << cache.size() << std::endl;
+
+    double t2 = _g_function(1.5, 2.5, g2);
+    long misses2 = cache.misses() - misses1;
+    long hits2 = cache.hits() - hits1;
+    std::cout << "Scaled field: " << t2 << " s, hits: " << hits2 << ", misses: " << misses2 << std::endl;
+
+    // the similarities are identified with dimensional tolerances, so the scaled field can have a few more
+    // classes than the original one; every value of the original field must be reused
+    if (hits2 < misses1 || double(misses2) > 0.05 * double(hits2 + misses2)) {
+        throw std::invalid_argument("The scaled field was not found in the FLS kernel cache.");
+    }
+    double error = 0;
+    for (int k=0; k<g2.size(); k++) {
+        error = std::max(error, std::abs(g2[k] - g2_reference[k]));
+    }
+    std::cout << "Maximum difference from the g-function computed without the cache: " << error << std::endl;
+    if (error > 1.0e-8) {
+        throw std::invalid_argument("The g-function computed with the FLS kernel cache does not match.");
+    }
+
+    cache.clear();
+    if (cache.size() != 0 || cache.hits() != 0 || cache.misses() != 0) {
+        throw std::invalid_argument("The FLS kernel cache was not cleared.");
+    }
+
+    return 0;
+}
@@ -0,0 +1,52 @@
+// Verifies that the g-function of the reconstructed loads aggregated to a few accuracy targets
+// (Options::superposition_tol) is within its target of the g-function of every time of the temporal superposition.
+
+#include <cpgfunction/coordinates.h>
+#include <cpgfunction/boreholes.h>
+#include <cpgfunction/utilities.h>
+#include <cpgfunction/gfunction.h>
+#include <cpgfunction/options.h>
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+#include <tuple>
+
+
+int main() {
+    // -- Borehole geometry --
+    double H = 100.;  // height of the borehole (in meters)
+    double D = 4.;  // burial depth (in meters)
+    double r_b = 0.075;  // borehole radius (in meters)
+    double alpha = 1.0e-06;  // ground thermal diffusivity
+    int nSegments = 4;
+
+    std::vector<std::tuple<double, double>> coordinates = gt::coordinates::configuration("Rectangle", 3, 3, 5., 5.);
+    std::vector<gt::boreholes::Borehole> boreField = gt::boreholes::boreField(coordinates, r_b, H, D);
+
+    // hourly to the steady-state, ln(t/ts) = 3
+    double ts = H * H / (9. * alpha);
+    std::vector<double> time = gt::utilities::time_geometric(3600., exp(3.) * ts, 60);
+    int nt = time.size();
+
+    gt::options::Options options;
+    options.fls_time_batch = true;
+    options.fls_vectorize = true;
+    std::vector<double> gFunction = gt::gfunction::uniform_borehole_wall_temperature(
+            boreField, time, alpha, nSegments, true, true, 0, true, false, options);
+    for (double tol : {1.0e-4, 1.0e-3, 1.0e-2}) {
+        options.superposition_tol = tol;
+        std::vector<double> gFunctionAggregated = gt::gfunction::uniform_borehole_wall_temperature(
+                boreField, time, alpha, nSegments, true, true, 0, true, false, options);
+
+        double g_error = 0;
+        for (int k=0; k<nt; k++) {
+            g_error = std::max(g_error, std::abs(gFunctionAggregated[k] - gFunction[k]) / gFunction[k]);
+        }
+        std::cout << "superposition_tol " << tol << ", maximum relative difference: " << g_error << std::endl;
+        if (g_error > tol) {
+            throw std::invalid_argument("The g-function of the aggregated loads is not within its accuracy target.");
+        }
+    }  // next tol
+
+    return 0;
+}
@@ -0,0 +1,72 @@
+// Verifies that the g-function solved with the packed LDL^T factorization of the segment block
+// (Options::packed_solver) is the g-function of the LU decomposition of the full system, with and without the
+// symmetries of the field, and that a singular system (two boreholes at the same position) throws with either
+// solver.
+
+#include <cpgfunction/coordinates.h>
+#include <cpgfunction/boreholes.h>
+#include <cpgfunction/utilities.h>
+#include <cpgfunction/gfunction.h>
+#include <cpgfunction/options.h>
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+#include <tuple>
+
+
+int main() {
+    // -- Borehole geometry --
+    double H = 100.;  // height of the borehole (in meters)
+    double D = 4.;  // burial depth (in meters)
+    double r_b = 0.075;  // borehole radius (in meters)
+    double alpha = 1.0e-06;  // ground thermal diffusivity
+    int nSegments = 6;
+
+    std::vector<double> time = gt::utilities::time_Eskilson(H, alpha);
+    int nt = time.size();
+
+    std::vector<std::tuple<double, double>> coordinates = gt::coordinates::configuration("Rectangle", 4, 4, 5., 5.);
+    std::vector<gt::boreholes::Borehole> boreField = gt::boreholes::boreField(coordinates, r_b, H, D);
+
+    for (int reduce=0; reduce<2; reduce++) {
+        gt::options::Options options;
+        options.fls_time_batch = true;
+        options.fls_vectorize = true;
+        options.symmetry_reduction = reduce == 1;
+        std::vector<double> g_dense = gt::gfunction::uniform_borehole_wall_temperature(
+                boreField, time, alpha, nSegments, true, true, 0, true, false, options);
+        options.packed_solver = true;
+        std::vector<double> g_packed = gt::gfunction::uniform_borehole_wall_temperature(
+                boreField, time, alpha, nSegments, true, true, 0, true, false, options);
+
+        double g_error = 0;
+        for (int k=0; k<nt; k++) {
+            g_error = std::max(g_error, std::abs(g_packed[k] - g_dense[k]) / g_dense[k]);
+        }
+        std::cout << (reduce == 1 ? "LDL^T (symmetry reduction)" : "LDL^T") << ", maximum relative difference: "
+                  << g_error << std::endl;
+        if (g_error > 1.0e-8) {
+            throw std::invalid_argument("The g-function of the packed solver differs.");
+        }
+    }  // next reduce
+
+    // two boreholes at the same position, their columns of the system of equations are the same
+    std::vector<std::tuple<double, double>> coincident{std::make_tuple(0., 0.), std::make_tuple(0., 0.)};
+    std::vector<gt::boreholes::Borehole> coincidentField = gt::boreholes::boreField(coincident, r_b, H, D);
+    for (int packed=0; packed<2; packed++) {
+        gt::options::Options options;
+        options.packed_solver = packed == 1;
+        bool singular = false;
+        try {
+            gt::gfunction::uniform_borehole_wall_temperature(coincidentField, time, alpha, 1, true, true, 0, true,
+                                                             false, options);
+        } catch (std::runtime_error &e) {
+            singular = true;
+        }
+        if (!singular) {
+            throw std::invalid_argument("The solution of a singular system of equations is used.");
+        }
+    }  // next packed
+
+    return 0;
+}
@@ -0,0 +1,143 @@
+// Computes the segment to segment response factors of a field many times over, concurrently and with different
+// numbers of threads, and verifies that every run is bit-identical and that no contribution of a similarity is lost
+// when compared to a serial accumulation of the same similarities. The similarity indexed storage (storage_mode 0)
+// must give the same response factors.
+
+#include <cpgfunction/coordinates.h>
+#include <cpgfunction/boreholes.h>
+#include <cpgfunction/utilities.h>
+#include <cpgfunction/executor.h>
+#include <cpgfunction/gfunction.h>
+#include <cpgfunction/heat_transfer.h>
+#include <cpgfunction/options.h>
+#include <cmath>
+#include <stdexcept>
+#include <thread>
+
+
+int main() {
+    int Nx = 8;
+    int Ny = 8;
+    double Bx = 6.;
+    double By = 4.5;
+    double H = 100.;
+    double D = 4.;
+    double r_b = 0.075;
+    double alpha = 1.0e-06;
+    int nSegments = 8;
+    std::vector<int> nThreads{1, 2, 4, 8};
+    int nConcurrent = 4;
+
+    std::vector<std::tuple<double, double>> coordinates = gt::coordinates::configuration("L", Nx, Ny, Bx, By);
+    std::vector<gt::boreholes::Borehole> boreField = gt::boreholes::boreField(coordinates, r_b, H, D);
+    std::vector<double> time = gt::utilities::time_Eskilson(H, alpha);
+    int nSources = nSegments * boreField.size();
+    int nSum = nSources * (nSources + 1) / 2;
+    int nt = time.size();
+    std::vector<gt::boreholes::Borehole> boreSegments(nSources);
+    gt::gfunction::_borehole_segments(boreSegments, boreField, nSegments);
+
+    // more workers than the sandbox has cores, so that the tasks are interleaved
+    gt::parallel::Executor executor(7);
+    gt::options::Options options;
+    options.fls_time_batch = true;
+    options.fls_vectorize = true;
+    options.executor = &executor;
+
+    auto _response_factors = [&](gt::heat_transfer::SegmentResponse &SegRes, const int n_Threads) {
+        std::vector<gt::boreholes::Borehole> segments = boreSegments;
+        std::vector<double> _time = time;
+        gt::heat_transfer::thermal_response_factors(SegRes, segments, _time, alpha, true, false, options, n_Threads);
+    };
+
+    // -- Serial accumulation of the similarities --
+    gt::heat_transfer::SegmentResponse reference(nSources, nSum, nt);
+    gt::boreholes::SimilaritiesType SimReal;
+    gt::boreholes::SimilaritiesType SimImage;
+    gt::boreholes::Similarity sim;
+    sim.similarities(SimReal, SimImage, boreSegments, true, 0.1, 1.0e-6);
+    for (int kind=0; kind<2; kind++) {
+        gt::boreholes::SimilaritiesType &SimT = kind == 0 ? SimReal : SimImage;
+        for (int s=0; s<SimT.nSim; s++) {
+            gt::boreholes::Borehole b1 = boreSegments[SimT.iSim[SimT.offset[s]]];
+            gt::boreholes::Borehole b2 = boreSegments[SimT.jSim[SimT.offset[s]]];
+            std::vector<double> h;
+            gt::heat_transfer::finite_line_source(h, time, alpha, b1, b2, kind == 0, kind == 1, true);
+            for (int64_t k=SimT.offset[s]; k<SimT.offset[s + 1]; k++) {
+                int i = SimT.iSim[k];
+                int j = SimT.jSim[k];
+                int index;
+                reference.get_index_value(index, std::min(i, j), std::max(i, j));
+                for (int t=0; t<nt; t++) {
+                    reference.slice(t)[index] += i <= j ? b2.H / b1.H * h[t] : h[t];
+                }  // next t
+            }
+        }  // next s
+    }
+
+    // -- Concurrent runs --
+    std::vector<gt::heat_transfer::SegmentResponse> results(nThreads.size() * nConcurrent,
+            gt::heat_transfer::SegmentResponse(nSources, nSum, nt));
+    for (int run=0; run<nThreads.size(); run++) {
+        std::vector<std::thread> threads;
+        for (int c=0; c<nConcurrent; c++) {
+            threads.emplace_back(_response_factors, std::ref(results[run * nConcurrent + c]), nThreads[run]);
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+    }  // next run
+
+    double error = 0;
+    for (int index=0; index<nSum; index++) {
+        for (int t=0; t<nt; t++) {
+            for (int r=1; r<results.size(); r++) {
+                if (results[r].slice(t)[index] != results[0].slice(t)[index]) {
+                    throw std::invalid_argument("The response factors differ between runs.");
+                }
+            }  // next r
+            double h_ref = reference.slice(t)[index];
+            error = std::max(error, std::abs(results[0].slice(t)[index] - h_ref) / std::max(std::abs(h_ref), 1.0e-300));
+        }  // next t
+    }  // next index
+    std::cout << results.size() << " runs of " << nSum << " x " << nt << " response factors are bit-identical, "
+              << "maximum relative difference from the serial accumulation: " << error << std::endl;
+    if (error > 1.0e-13) {
+        throw std::invalid_argument("The response factors do not match the serial accumulation.");
+    }
+
+    // -- Similarity indexed storage --
+    gt::heat_transfer::SegmentResponse indexed(nSources, nSum, nt, 0);
+    indexed.boreSegments = boreSegments;
+    results[0].boreSegments = boreSegments;
+    _response_factors(indexed, 0);
+    for (int i=0; i<nSources; i++) {
+        for (int j=0; j<nSources; j++) {
+            for (int t=0; t<nt; t++) {
+                double h;
+                double h_indexed;
+                results[0].get_h_value(h, i, j, t);
+                indexed.get_h_value(h_indexed, i, j, t);
+                if (h != h_indexed) {
+                    throw std::invalid_argument("The similarity indexed response factors differ.");
+                }
+            }  // next t
+        }  // next j
+    }  // next i
+    std::vector<double> buffer(nSum);
+    for (int t=0; t<nt; t++) {
+        const double *h_indexed = indexed.time_slice(t, buffer.data());
+        for (int index=0; index<nSum; index++) {
+            if (h_indexed[index] != results[0].slice(t)[index]) {
+                throw std::invalid_argument("The similarity indexed time slices differ.");
+            }
+        }  // next index
+    }  // next t
+    double bytes = double(nSum) * nt * sizeof(double);
+    double bytes_indexed = double(indexed.hSim.size() + indexed.ratioSim.size()) * sizeof(double)
+            + double(indexed.simOf.size()) * sizeof(int);
+    std::cout << "storage_mode 1: " << bytes / 1.0e6 << " MB, storage_mode 0 (" << indexed.nSim
+              << " similarities): " << bytes_indexed / 1.0e6 << " MB" << std::endl;
+
+    return 0;
+}
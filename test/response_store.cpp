@@ -0,0 +1,171 @@
+// Computes a g-function with the response factor store enabled, then again reading the response factors back from
+// the store, and verifies that both give the same g-function. A truncated table must be integrated again, and so
+// must the response factors of another pruning tolerance. The same table saved by several threads at once is stored
+// whole and leaves no temporary file behind.
+
+#include <cpgfunction/coordinates.h>
+#include <cpgfunction/boreholes.h>
+#include <cpgfunction/utilities.h>
+#include <cpgfunction/gfunction.h>
+#include <cpgfunction/options.h>
+#include <cpgfunction/response_store.h>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+#include <dirent.h>
+#include <unistd.h>
+
+
+int main() {
+    int Nx = 10;
+    int Ny = 10;
+    double Bx = 6.;
+    double By = 4.5;
+    double H = 100.;
+    double D = 4.;
+    double r_b = 0.075;
+    double alpha = 1.0e-06;
+    int nSegments = 12;
+
+    std::vector<std::tuple<double, double>> coordinates = gt::coordinates::configuration("U", Nx, Ny, Bx, By);
+    std::vector<gt::boreholes::Borehole> boreField = gt::boreholes::boreField(coordinates, r_b, H, D);
+    std::vector<double> time = gt::utilities::time_Eskilson(H, alpha);
+
+    gt::options::Options options;
+    std::string store_directory = "response_factor_store";
+    options.response_store = store_directory;
+
+    // the table of this field
+    std::vector<gt::boreholes::Borehole> boreSegments(nSegments * boreField.size());
+    gt::gfunction::_borehole_segments(boreSegments, boreField, nSegments);
+    gt::heat_transfer::ResponseFactorStore store(options.response_store);
+    gt::heat_transfer::ResponseSettings settings(options, true, 1);
+    std::string path = store.path(gt::heat_transfer::ResponseFactorStore::key(boreSegments, time, alpha, nSegments,
+                                                                               settings));
+    std::remove(path.c_str());
+
+    auto _g_function = [&](std::vector<double> &gFunction) {
+        auto start = std::chrono::steady_clock::now();
+        gFunction = gt::gfunction::uniform_borehole_wall_temperature(boreField, time, alpha, nSegments, true,
+                                                                      true, 1, true, false, options);
+        auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1.0e6;
+    };
+    auto _equal = [](std::vector<double> &a, std::vector<double> &b) {
+        for (int k=0; k<a.size(); k++) {
+            if (a[k] != b[k]) {
+                return false;
+            }
+        }
+        return a.size() == b.size();
+    };
+
+    std::vector<double> g_computed;
+    std::vector<double> g_stored;
+    double t_computed = _g_function(g_computed);
+    if (access(path.c_str(), F_OK) != 0) {
+        throw std::invalid_argument("The response factors were not written to " + path);
+    }
+    double t_stored = _g_function(g_stored);
+    std::cout << "Integrated response factors: " << t_computed << " s, stored response factors: " << t_stored
+              << " s" << std::endl;
+    if (!_equal(g_computed, g_stored)) {
+        throw std::invalid_argument("The g-function computed from the stored response factors does not match.");
+    }
+
+    // a truncated table is a miss, and is replaced
+    if (truncate(path.c_str(), 1000) != 0) {
+        throw std::invalid_argument("Unable to truncate " + path);
+    }
+    _g_function(g_stored);
+    if (!_equal(g_computed, g_stored)) {
+        throw std::invalid_argument("The g-function computed after truncating the stored table does not match.");
+    }
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (in.tellg() <= 1000) {
+        throw std::invalid_argument("The truncated table was not replaced.");
+    }
+
+    // a table of pruned response factors is kept apart from the exact one, changing fls_prune_tol is a miss
+    std::vector<double> g_pruned;
+    options.fls_prune_tol = 1.0e-4;
+    gt::heat_transfer::ResponseSettings pruned_settings(options, true, 1);
+    std::string pruned_path = store.path(gt::heat_transfer::ResponseFactorStore::key(
+            boreSegments, time, alpha, nSegments, pruned_settings));
+    std::remove(pruned_path.c_str());
+    if (pruned_path == path) {
+        throw std::invalid_argument("The pruned and the exact response factors have the same key.");
+    }
+    _g_function(g_pruned);
+    if (access(pruned_path.c_str(), F_OK) != 0) {
+        throw std::invalid_argument("The pruned response factors were read from the table of the exact ones.");
+    }
+    if (_equal(g_computed, g_pruned)) {
+        throw std::invalid_argument("The pruned g-function is the exact one.");
+    }
+    std::vector<double> g_unstored;
+    options.response_store = "";
+    _g_function(g_unstored);
+    if (!_equal(g_pruned, g_unstored)) {
+        throw std::invalid_argument("The pruned g-function is not computed from the pruned response factors.");
+    }
+    // and back to the exact table
+    options.response_store = store_directory;
+    options.fls_prune_tol = 0.;
+    _g_function(g_stored);
+    if (!_equal(g_computed, g_stored)) {
+        throw std::invalid_argument("The exact g-function is not computed from the exact response factors.");
+    }
+
+    std::remove(path.c_str());
+    std::remove(pruned_path.c_str());
+
+    // the table of a small field saved by several threads at once
+    int nSegments_small = 24;
+    std::vector<gt::boreholes::Borehole> boreSegments_small(nSegments_small * 4);
+    std::vector<gt::boreholes::Borehole> boreField_small = gt::boreholes::boreField(
+            gt::coordinates::configuration("Rectangle", 2, 2, Bx, By), r_b, H, D);
+    gt::gfunction::_borehole_segments(boreSegments_small, boreField_small, nSegments_small);
+    int nSources = boreSegments_small.size();
+    int nSum = nSources * (nSources + 1) / 2;
+    int nt = time.size();
+    gt::heat_transfer::SegmentResponse SegRes(nSources, nSum, nt);
+    gt::heat_transfer::thermal_response_factors(SegRes, boreSegments_small, time, alpha, true, false, options);
+    gt::heat_transfer::ResponseSettings small_settings(options, true, 1);
+    std::string small_path = store.path(gt::heat_transfer::ResponseFactorStore::key(
+            boreSegments_small, time, alpha, nSegments_small, small_settings));
+    for (int round=0; round<4; round++) {
+        std::remove(small_path.c_str());
+        std::vector<std::thread> writers;
+        for (int w=0; w<8; w++) {
+            writers.emplace_back([&] {
+                store.save(SegRes, boreSegments_small, time, alpha, nSegments_small, small_settings);
+            });
+        }
+        for (auto &writer : writers) {
+            writer.join();
+        }
+        gt::heat_transfer::SegmentResponse SegRes_stored(nSources, nSum, 0);
+        if (!store.load(SegRes_stored, boreSegments_small, time, alpha, nSegments_small, small_settings)) {
+            throw std::invalid_argument("The table saved by several threads was not stored whole.");
+        }
+        for (size_t n=0; n<size_t(nt) * nSum; n++) {
+            if (SegRes_stored.h_ij[n] != SegRes.h_ij[n]) {
+                throw std::invalid_argument("The table saved by several threads does not match.");
+            }
+        }
+    }  // next round
+    DIR *directory = opendir(store_directory.c_str());
+    for (dirent *entry = readdir(directory); entry != nullptr; entry = readdir(directory)) {
+        if (std::string(entry->d_name).find(".hij.") != std::string::npos) {
+            closedir(directory);
+            throw std::invalid_argument(std::string("A temporary file was left in the store: ") + entry->d_name);
+        }
+    }
+    closedir(directory);
+    std::remove(small_path.c_str());
+
+    return 0;
+}
@@ -0,0 +1,66 @@
+// Verifies the response factors of a time step shorter than the first time value, which are interpolated linearly
+// from 0 to the response factors of the first time (jcc::interpolation::interp_weights). For a single segment the
+// heat extraction rate reconstructed before the second time is the first one, so the g-function at the second time
+// is h(dt[1]) + h(time[1]) - h(time[0]) with h(dt[1]) = dt[1] / time[0] * h(time[0]).
+
+#include <cpgfunction/boreholes.h>
+#include <cpgfunction/gfunction.h>
+#include <cpgfunction/interpolation.h>
+#include <cpgfunction/options.h>
+#include <cmath>
+#include <stdexcept>
+
+
+int main() {
+    double H = 100.;
+    double D = 4.;
+    double r_b = 0.075;
+    double alpha = 1.0e-06;
+    int nSegments = 1;
+    std::vector<gt::boreholes::Borehole> boreField = gt::boreholes::boreField({std::make_tuple(0., 0.)}, r_b, H, D);
+
+    // every step after the first is shorter than the first time value
+    double hour = 3600.;
+    std::vector<double> time {24. * hour, 26. * hour, 30. * hour, 36. * hour, 46. * hour};
+
+    int k;
+    double w0;
+    double w1;
+    jcc::interpolation::interp_weights(6. * hour, time, k, w0, w1);
+    if (k != 0 || std::abs(w0 - 0.25) > 1.0e-15 || w1 != 0) {
+        throw std::invalid_argument("The weights of a time step shorter than the first time are not h(0) dt / t_0.");
+    }
+
+    // the response factors of the first two times, the g-functions of these times alone
+    std::vector<double> h(2);
+    for (int p=0; p<2; p++) {
+        std::vector<double> time_p {time[p]};
+        h[p] = gt::gfunction::uniform_borehole_wall_temperature(
+                boreField, time_p, alpha, nSegments, false, true, 1, false, false)[0];
+    }
+    double expected = (time[1] - time[0]) / time[0] * h[0] + h[1] - h[0];
+
+    std::vector<double> reference;
+    for (int solver=0; solver<3; solver++) {
+        gt::options::Options options;
+        options.packed_solver = solver == 1;
+        options.iterative_solver = solver == 2;
+        std::vector<double> gFunction = gt::gfunction::uniform_borehole_wall_temperature(
+                boreField, time, alpha, nSegments, false, true, 1, false, false, options);
+        if (std::abs(gFunction[0] - h[0]) > 1.0e-10 * h[0] || std::abs(gFunction[1] - expected) > 1.0e-10 * expected) {
+            throw std::invalid_argument("The g-function after a step shorter than the first time ("
+                                        + std::to_string(gFunction[1]) + ") is not the one interpolated from h(0) ("
+                                        + std::to_string(expected) + ").");
+        }
+        if (solver == 0) {
+            reference = gFunction;
+        }
+        for (int p=0; p<time.size(); p++) {
+            if (std::abs(gFunction[p] - reference[p]) > 1.0e-8 * reference[p]) {
+                throw std::invalid_argument("The solvers differ after steps shorter than the first time.");
+            }
+        }  // next p
+    }  // next solver
+
+    return 0;
+}
@@ -0,0 +1,177 @@
+// Finds the similarity classes of a field of boreholes of varied H and D (real, image and realandimage) and
+// compares them with those of the scan over every class (the previous implementation), reporting the time of both.
+// The similarities of every distance are then found in parallel and compared with those found serially, and the
+// memory of the compressed sparse row layout of SimilaritiesType is compared with the nested vectors it replaced.
+
+#include <cpgfunction/boreholes.h>
+#include <cpgfunction/gfunction.h>
+#include <cpgfunction/executor.h>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+
+// The previous layout of the similarities, a vector of pairs per similarity
+struct NestedSimilarities {
+    int nSim = 0;
+    std::vector<std::vector<std::tuple<int, int>>> Sim;
+    std::vector<std::tuple<double, double>> HSim;
+    std::vector<std::tuple<double, double>> DSim;
+};
+
+bool same(gt::boreholes::SimilaritiesType &SimT, NestedSimilarities &nested) {
+    if (SimT.nSim != nested.nSim || SimT.offset.size() != SimT.nSim + 1) {
+        return false;
+    }
+    for (int s=0; s<SimT.nSim; s++) {
+        if (SimT.nPairs(s) != nested.Sim[s].size() || SimT.H1Sim[s] != std::get<0>(nested.HSim[s])
+                || SimT.H2Sim[s] != std::get<1>(nested.HSim[s]) || SimT.D1Sim[s] != std::get<0>(nested.DSim[s])
+                || SimT.D2Sim[s] != std::get<1>(nested.DSim[s])) {
+            return false;
+        }
+        for (int k=0; k<SimT.nPairs(s); k++) {
+            if (SimT.iSim[SimT.offset[s] + k] != std::get<0>(nested.Sim[s][k])
+                    || SimT.jSim[SimT.offset[s] + k] != std::get<1>(nested.Sim[s][k])) {
+                return false;
+            }
+        }  // next k
+    }  // next s
+    return true;
+}
+
+// The scan over every class found so far
+void class_scan(NestedSimilarities &SimT, std::vector<std::tuple<int, int>> &pairs,
+                std::vector<gt::boreholes::Borehole> &boreSegments, const std::string &kind, const double tol) {
+    auto compare = [&kind, &tol](double H1a, double H1b, double H2a, double H2b, double D1a, double D1b,
+                                 double D2a, double D2b) {
+        bool similarity = std::abs((H1a - H1b) / H1a) < tol && std::abs((H2a - H2b) / H2a) < tol;
+        if (kind == "real") {
+            return similarity && std::abs(((D2a - D1a) - (D2b - D1b)) / (D2a - D1a + 1e-30)) < tol;
+        } else if (kind == "image") {
+            return similarity && std::abs(((D2a + D1a) - (D2b + D1b)) / (D2a + D1a + 1e-30)) < tol;
+        }
+        return similarity && std::abs((D1a - D1b) / (D1a + 1e-30)) < tol
+                && std::abs((D2a - D2b) / (D2a + 1e-30)) < tol;
+    };
+    int i0 = std::get<0>(pairs[0]);
+    int j0 = std::get<1>(pairs[0]);
+    SimT.nSim = 1;
+    SimT.Sim.assign(1, std::vector<std::tuple<int, int>>(1, pairs[0]));
+    SimT.HSim.assign(1, std::make_tuple(boreSegments[i0].H, boreSegments[j0].H));
+    SimT.DSim.assign(1, std::make_tuple(boreSegments[i0].D, boreSegments[j0].D));
+    for (int i=1; i<pairs.size(); i++) {
+        int ibor = std::min(std::get<0>(pairs[i]), std::get<1>(pairs[i]));
+        int jbor = std::max(std::get<0>(pairs[i]), std::get<1>(pairs[i]));
+        gt::boreholes::Borehole &b1 = boreSegments[ibor];
+        gt::boreholes::Borehole &b2 = boreSegments[jbor];
+        for (int j=0; j<SimT.nSim; j++) {
+            double H1 = std::get<0>(SimT.HSim[j]);
+            double H2 = std::get<1>(SimT.HSim[j]);
+            double D1 = std::get<0>(SimT.DSim[j]);
+            double D2 = std::get<1>(SimT.DSim[j]);
+            if (compare(H1, b1.H, H2, b2.H, D1, b1.D, D2, b2.D)) {
+                SimT.Sim[j].push_back(std::make_tuple(ibor, jbor));
+                break;
+            } else if (compare(H1, b2.H, H2, b1.H, D1, b2.D, D2, b1.D)) {
+                SimT.Sim[j].push_back(std::make_tuple(jbor, ibor));
+                break;
+            } else if (j == SimT.nSim - 1) {
+                SimT.nSim++;
+                SimT.Sim.push_back(std::vector<std::tuple<int, int>>(1, std::make_tuple(ibor, jbor)));
+                SimT.HSim.push_back(std::make_tuple(b1.H, b2.H));
+                SimT.DSim.push_back(std::make_tuple(b1.D, b2.D));
+                break;
+            }
+        }  // next j
+    }  // next i
+}
+
+int main() {
+    // a row of boreholes 6 m apart with 6 lengths and 3 burial depths, so that the classes of a distance are many
+    int nBoreholes = 60;
+    int nSegments = 12;
+    std::vector<gt::boreholes::Borehole> boreField;
+    for (int b=0; b<nBoreholes; b++) {
+        boreField.emplace_back(80. + 10. * (b % 6), 2. + 2. * (b % 3), 0.075, 6. * b, 0.);
+    }
+    std::vector<gt::boreholes::Borehole> boreSegments(nBoreholes * nSegments);
+    gt::gfunction::_borehole_segments(boreSegments, boreField, nSegments);
+
+    gt::boreholes::Similarity sim;
+    std::vector<std::vector<std::tuple<int, int>>> Pairs;
+    std::vector<int> nPairs;
+    std::vector<double> disPairs;
+    int nDis;
+    sim._similarities_group_by_distance(boreSegments, Pairs, nPairs, disPairs, nDis);
+
+    auto _seconds = [](std::chrono::steady_clock::time_point start) {
+        auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1.0e6;
+    };
+
+    for (const std::string kind : {"real", "image", "realandimage"}) {
+        double t_scan = 0.;
+        double t_hash = 0.;
+        long nSim = 0;
+        for (int k=0; k<nDis; k++) {
+            NestedSimilarities SimScan;
+            auto start = std::chrono::steady_clock::now();
+            class_scan(SimScan, Pairs[k], boreSegments, kind, 1.0e-6);
+            t_scan += _seconds(start);
+
+            gt::boreholes::SimilaritiesType SimHash;
+            start = std::chrono::steady_clock::now();
+            sim._similarities_one_distance(SimHash, Pairs[k], boreSegments, kind);
+            t_hash += _seconds(start);
+
+            if (!same(SimHash, SimScan)) {
+                throw std::invalid_argument("The " + kind + " classes are not those of the scan over the classes.");
+            }
+            nSim += SimHash.nSim;
+        }  // next k
+        std::cout << kind << ": " << nSim << " classes over " << nDis << " distances; scan: " << t_scan
+                  << " s, hash index: " << t_hash << " s" << std::endl;
+    }
+
+    // -- The similarities of every distance found in parallel --
+    gt::parallel::Executor executor(3);
+    std::vector<gt::boreholes::SimilaritiesType> SimReal(2);
+    std::vector<gt::boreholes::SimilaritiesType> SimImage(2);
+    std::vector<int> threads{1, 4};
+    for (int n=0; n<2; n++) {
+        gt::parallel::TaskGroup pool(executor, threads[n]);
+        auto start = std::chrono::steady_clock::now();
+        sim.similarities(SimReal[n], SimImage[n], boreSegments, true, 0.1, 1.0e-6, &pool);
+        std::cout << "similarities, " << threads[n] << " thread(s): " << _seconds(start) << " s" << std::endl;
+    }  // next n
+    for (gt::boreholes::SimilaritiesType *SimT : {SimReal.data(), SimImage.data()}) {
+        if (SimT[0].nSim != SimT[1].nSim || SimT[0].offset != SimT[1].offset || SimT[0].iSim != SimT[1].iSim
+                || SimT[0].jSim != SimT[1].jSim || SimT[0].H1Sim != SimT[1].H1Sim || SimT[0].H2Sim != SimT[1].H2Sim
+                || SimT[0].D1Sim != SimT[1].D1Sim || SimT[0].D2Sim != SimT[1].D2Sim
+                || SimT[0].disSim != SimT[1].disSim || SimT[0].disSim.size() != SimT[0].nSim) {
+            throw std::invalid_argument("The similarities found in parallel are not those found serially.");
+        }
+    }
+
+    // -- Memory of the layouts --
+    // the nested vectors took one allocation per similarity (of at least 32 bytes with the allocator's header)
+    // besides the 24 byte vector itself, 8 bytes per pair, 32 bytes of H and D and 8 bytes of distance per similarity
+    size_t bytes_csr = SimReal[0].bytes() + SimImage[0].bytes();
+    size_t bytes_nested = 0;
+    long nAllocations = 0;
+    long nPairsTotal = 0;
+    for (gt::boreholes::SimilaritiesType *SimT : {&SimReal[0], &SimImage[0]}) {
+        for (int s=0; s<SimT->nSim; s++) {
+            bytes_nested += 24 + std::max(size_t(SimT->nPairs(s) * 8 + 8), size_t(32)) + 32 + 8;
+        }
+        nAllocations += SimT->nSim + 4;
+        nPairsTotal += SimT->offset[SimT->nSim];
+    }
+    std::cout << nPairsTotal << " pairs; nested vectors: " << bytes_nested / 1.0e6 << " MB in " << nAllocations
+              << " allocations, compressed sparse rows: " << bytes_csr / 1.0e6 << " MB in 18 allocations"
+              << std::endl;
+    if (bytes_csr >= bytes_nested) {
+        throw std::invalid_argument("The compressed sparse row layout does not take less memory.");
+    }
+
+    return 0;
+}
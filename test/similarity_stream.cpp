@@ -0,0 +1,113 @@
+// Computes the segment to segment response factors with the similarities streamed (Options::similarity_stream) and
+// with the pairs of every similarity listed, verifies that they are bit-identical in both storage modes, then
+// measures the peak resident memory of both on a larger field, each in a process of its own.
+
+#include <cpgfunction/coordinates.h>
+#include <cpgfunction/boreholes.h>
+#include <cpgfunction/utilities.h>
+#include <cpgfunction/gfunction.h>
+#include <cpgfunction/heat_transfer.h>
+#include <cpgfunction/options.h>
+#include <stdexcept>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+
+void response_factors(gt::heat_transfer::SegmentResponse &SegRes, std::vector<gt::boreholes::Borehole> &boreField,
+                      std::vector<double> &time, const double alpha, const int nSegments, const bool stream) {
+    std::vector<gt::boreholes::Borehole> boreSegments(SegRes.nSources);
+    gt::gfunction::_borehole_segments(boreSegments, boreField, nSegments);
+    gt::options::Options options;
+    options.similarity_stream = stream;
+    gt::heat_transfer::thermal_response_factors(SegRes, boreSegments, time, alpha, true, false, options);
+}
+
+// The peak resident memory (in kB) of computing the response factors in a child process
+long peak_memory(std::vector<gt::boreholes::Borehole> &boreField, std::vector<double> &time, const double alpha,
+                 const int nSegments, const bool stream) {
+    int fd[2];
+    if (pipe(fd) != 0) {
+        throw std::runtime_error("Unable to create a pipe.");
+    }
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fd[0]);
+        int nSources = nSegments * boreField.size();
+        gt::heat_transfer::SegmentResponse SegRes(nSources, nSources * (nSources + 1) / 2, time.size(), 0);
+        response_factors(SegRes, boreField, time, alpha, nSegments, stream);
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        long peak = usage.ru_maxrss;
+        ssize_t written = write(fd[1], &peak, sizeof(peak));
+        close(fd[1]);
+        _exit(written == sizeof(peak) ? 0 : 1);
+    }
+    close(fd[1]);
+    long peak = -1;
+    ssize_t n = read(fd[0], &peak, sizeof(peak));
+    close(fd[0]);
+    int status;
+    waitpid(pid, &status, 0);
+    if (n != sizeof(peak) || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        throw std::runtime_error("The response factors were not computed in the child process.");
+    }
+    return peak;
+}
+
+int main() {
+    double H = 100.;
+    double D = 4.;
+    double r_b = 0.075;
+    double alpha = 1.0e-06;
+
+    // -- Bit-identical response factors --
+    {
+        int nSegments = 8;
+        std::vector<std::tuple<double, double>> coordinates = gt::coordinates::configuration("L", 8, 8, 6., 4.5);
+        std::vector<gt::boreholes::Borehole> boreField = gt::boreholes::boreField(coordinates, r_b, H, D);
+        std::vector<double> time = gt::utilities::time_Eskilson(H, alpha);
+        int nSources = nSegments * boreField.size();
+        int nSum = nSources * (nSources + 1) / 2;
+        int nt = time.size();
+        for (int storage_mode : {1, 0}) {
+            gt::heat_transfer::SegmentResponse listed(nSources, nSum, nt, storage_mode);
+            gt::heat_transfer::SegmentResponse streamed(nSources, nSum, nt, storage_mode);
+            response_factors(listed, boreField, time, alpha, nSegments, false);
+            response_factors(streamed, boreField, time, alpha, nSegments, true);
+            std::vector<double> buffer(nSum);
+            std::vector<double> buffer_streamed(nSum);
+            for (int t=0; t<nt; t++) {
+                const double *h = listed.time_slice(t, buffer.data());
+                const double *h_streamed = streamed.time_slice(t, buffer_streamed.data());
+                for (int index=0; index<nSum; index++) {
+                    if (h[index] != h_streamed[index]) {
+                        throw std::invalid_argument("The streamed response factors differ.");
+                    }
+                }  // next index
+            }  // next t
+            if (storage_mode == 0 && (listed.simOf != streamed.simOf || listed.hSim != streamed.hSim)) {
+                throw std::invalid_argument("The streamed similarities differ.");
+            }
+        }
+        std::cout << "The streamed response factors of " << nSum << " pairs are bit-identical" << std::endl;
+    }
+
+    // -- Peak memory --
+    int nSegments = 12;
+    std::vector<std::tuple<double, double>> coordinates = gt::coordinates::configuration("Rectangle", 16, 16, 5., 5.);
+    std::vector<gt::boreholes::Borehole> boreField = gt::boreholes::boreField(coordinates, r_b, H, D);
+    std::vector<double> time = gt::utilities::time_Eskilson(H, alpha);
+    time.resize(3);
+    int nSources = nSegments * boreField.size();
+    long peak_listed = peak_memory(boreField, time, alpha, nSegments, false);
+    long peak_streamed = peak_memory(boreField, time, alpha, nSegments, true);
+    std::cout << "16 x 16 boreholes x " << nSegments << " segments (" << long(nSources) * (nSources + 1) / 2
+              << " pairs), storage_mode 0, peak resident memory; listed: " << peak_listed / 1024. << " MB, streamed: "
+              << peak_streamed / 1024. << " MB" << std::endl;
+    if (peak_streamed >= peak_listed) {
+        throw std::invalid_argument("Streaming the similarities does not lower the peak memory.");
+    }
+
+    return 0;
+}
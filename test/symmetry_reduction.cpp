@@ -0,0 +1,74 @@
+// Finds the symmetry group of regular fields and verifies that the g-function solved for one segment of each orbit
+// of the symmetries (Options::symmetry_reduction) is the g-function of the full system, reporting the time of both
+// (the response factors included)
+
+#include <cpgfunction/coordinates.h>
+#include <cpgfunction/boreholes.h>
+#include <cpgfunction/utilities.h>
+#include <cpgfunction/gfunction.h>
+#include <cpgfunction/options.h>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+
+
+int main() {
+    double H = 100.;
+    double D = 4.;
+    double r_b = 0.075;
+    double alpha = 1.0e-06;
+    int nSegments = 12;
+
+    struct Field {
+        std::string shape;
+        int Nx;
+        int Ny;
+        double Bx;
+        double By;
+        int order;  // order of the symmetry group
+    };
+    std::vector<Field> fields{{"Rectangle", 8, 8, 5., 5., 8}, {"Rectangle", 8, 6, 6., 4.5, 4},
+                              {"OpenRectangle", 12, 8, 6., 4.5, 4}, {"U", 12, 8, 6., 4.5, 2},
+                              {"L", 12, 12, 5., 5., 2}};
+
+    auto _seconds = [](std::chrono::steady_clock::time_point start) {
+        auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1.0e6;
+    };
+
+    std::vector<double> time = gt::utilities::time_Eskilson(H, alpha);
+    for (auto &field : fields) {
+        std::vector<std::tuple<double, double>> coordinates = gt::coordinates::configuration(
+                field.shape, field.Nx, field.Ny, field.Bx, field.By);
+        std::vector<gt::boreholes::Borehole> boreField = gt::boreholes::boreField(coordinates, r_b, H, D);
+        int order = gt::boreholes::symmetry_group(boreField).size();
+        if (order != field.order) {
+            throw std::invalid_argument("The symmetry group of the " + field.shape + " field is of order "
+                                        + std::to_string(order) + ", not " + std::to_string(field.order) + ".");
+        }
+
+        gt::options::Options options;
+        std::vector<double> g_full;
+        std::vector<double> g_reduced;
+        std::vector<double> t(2);
+        for (int reduce=0; reduce<2; reduce++) {
+            options.symmetry_reduction = reduce == 1;
+            auto start = std::chrono::steady_clock::now();
+            (reduce == 0 ? g_full : g_reduced) = gt::gfunction::uniform_borehole_wall_temperature(
+                    boreField, time, alpha, nSegments, true, true, 0, true, false, options);
+            t[reduce] = _seconds(start);
+        }  // next reduce
+        double error = 0.;
+        for (int k=0; k<time.size(); k++) {
+            error = std::max(error, std::abs(g_reduced[k] - g_full[k]) / std::abs(g_full[k]));
+        }
+        std::cout << field.shape << " " << field.Nx << " x " << field.Ny << " (symmetry group of order " << order
+                  << "), full: " << t[0] << " s, reduced: " << t[1] << " s, maximum relative difference: " << error
+                  << std::endl;
+        if (error > 1.0e-8) {
+            throw std::invalid_argument("The g-function of the reduced system differs.");
+        }
+    }
+
+    return 0;
+}